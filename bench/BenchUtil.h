@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <sys/resource.h>
+#include <vector>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// Nearest-rank percentile (p in 0..100) of `v`; 0 when empty.
+inline double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    const size_t rank = static_cast<size_t>(p / 100.0 * (v.size() - 1) + 0.5);
+    std::nth_element(v.begin(), v.begin() + rank, v.end());
+    return v[rank];
+}
+
+// Resident set size of this process right now, in bytes (0 if unknown).
+inline size_t current_rss_bytes() {
+#ifdef __APPLE__
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                  reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return static_cast<size_t>(info.resident_size);
+#else
+    long pages = 0, resident = 0;
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    const int n = std::fscanf(f, "%ld %ld", &pages, &resident);
+    std::fclose(f);
+    return n == 2 ? static_cast<size_t>(resident) * 4096u : 0;
+#endif
+}
+
+// Peak resident set size since process start, in bytes.
+inline size_t peak_rss_bytes() {
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+    return static_cast<size_t>(ru.ru_maxrss);
+#else
+    return static_cast<size_t>(ru.ru_maxrss) * 1024u;
+#endif
+}
+
+} // namespace bench
@@ -0,0 +1,223 @@
+// Stop-to-text latency: replays a directory of WAV files through
+// WhisperProcessor::transcribe and reports p50/p95/p99 per stage, real-time
+// factor and peak RSS for every combination of the sweep parameters.
+//
+//   rose_bench_e2e --wav-dir DIR [--models tiny,base|PATH,...] [--best-of 1,5]
+//                  [--threads 2,4] [--language en,auto] [--runs N] [--gpu]
+//                  [--json FILE]
+//
+// CPU-only by default, so a Linux box with ggml-tiny.bin in models/ is enough.
+// Peak RSS is the process high-water mark so far; list models smallest first.
+
+#include "AudioFile.h"
+#include "BenchUtil.h"
+#include "Constants.h"
+#include "Json.h"
+#include "ModelCatalog.h"
+#include "WhisperProcessor.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Clip {
+    std::string path;
+    std::vector<float> pcm;
+    double seconds;
+};
+
+std::vector<std::string> split_list(const std::string& list) {
+    std::vector<std::string> out;
+    std::stringstream in(list);
+    for (std::string item; std::getline(in, item, ',');) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+std::vector<int> int_list(const std::string& list) {
+    std::vector<int> out;
+    for (const auto& s : split_list(list)) out.push_back(std::max(1, std::atoi(s.c_str())));
+    return out;
+}
+
+std::vector<Clip> load_clips(const std::string& dir) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (const auto& e : fs::recursive_directory_iterator(dir, ec)) {
+        std::string ext = e.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (e.is_regular_file(ec) && ext == ".wav") paths.push_back(e.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<Clip> clips;
+    for (const auto& p : paths) {
+        Clip c;
+        c.path = p;
+        std::string error;
+        if (!audio::load_wav(p, constants::kSampleRate, c.pcm, &error)) {
+            std::cerr << "skipping " << p << ": " << error << "\n";
+            continue;
+        }
+        c.seconds = static_cast<double>(c.pcm.size()) / constants::kSampleRate;
+        clips.push_back(std::move(c));
+    }
+    return clips;
+}
+
+// A model family resolves through the catalog; anything else is a path.
+std::string resolve(const std::string& model, bool gpu) {
+    if (fs::is_regular_file(model)) return model;
+    return models::resolve(model, constants::kDefaultQuantization, gpu);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string wav_dir;
+    std::vector<std::string> model_list = { "tiny" };
+    std::vector<int> best_of = { 1 };
+    std::vector<int> threads = { constants::kWhisperThreads };
+    std::vector<std::string> languages = { "en" };
+    int runs = 1;
+    bool gpu = false;
+    std::string json_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has = i + 1 < argc;
+        if (arg == "--wav-dir" && has) wav_dir = argv[++i];
+        else if (arg == "--models" && has) model_list = split_list(argv[++i]);
+        else if (arg == "--best-of" && has) best_of = int_list(argv[++i]);
+        else if (arg == "--threads" && has) threads = int_list(argv[++i]);
+        else if (arg == "--language" && has) languages = split_list(argv[++i]);
+        else if (arg == "--runs" && has) runs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--gpu") gpu = true;
+        else if (arg == "--json" && has) json_path = argv[++i];
+        else {
+            wav_dir.clear();
+            break;
+        }
+    }
+    if (wav_dir.empty()) {
+        std::cerr << "usage: rose_bench_e2e --wav-dir DIR [--models tiny,base|PATH,...] [--best-of 1,5]\n"
+                     "                      [--threads 2,4] [--language en,auto] [--runs N] [--gpu] [--json FILE]\n";
+        return 2;
+    }
+
+    const std::vector<Clip> clips = load_clips(wav_dir);
+    if (clips.empty()) {
+        std::cerr << "no WAV files under " << wav_dir << "\n";
+        return 1;
+    }
+    double corpus_seconds = 0.0;
+    for (const auto& c : clips) corpus_seconds += c.seconds;
+    std::cout << clips.size() << " clips, " << std::fixed << std::setprecision(1) << corpus_seconds
+              << " s of audio, " << runs << " run(s) per configuration\n" << std::defaultfloat;
+
+    std::ofstream json_out;
+    if (!json_path.empty()) {
+        json_out.open(json_path);
+        if (!json_out.is_open()) {
+            std::cerr << "cannot write " << json_path << "\n";
+            return 2;
+        }
+    }
+
+    for (const auto& model : model_list) {
+        const std::string path = resolve(model, gpu);
+        if (path.empty()) {
+            std::cerr << "no model for " << model << "\n";
+            continue;
+        }
+        WhisperProcessor processor;
+        processor.setLogging(false);
+        const auto t_load = bench::Clock::now();
+        if (!processor.initialize(path, gpu)) {
+            std::cerr << "failed to load " << path << "\n";
+            continue;
+        }
+        const double load_ms = bench::ms_since(t_load);
+        DecodeOptions warm;
+        if (!best_of.empty()) warm.bestOfN = *std::max_element(best_of.begin(), best_of.end());
+        if (!threads.empty()) warm.threads = threads.front();
+        warm.gpu = gpu;
+        processor.warmUp(warm);
+        const std::string name = fs::path(path).filename().string();
+
+        for (int n : best_of) {
+            for (int thr : threads) {
+                for (const auto& lang : languages) {
+                    DecodeOptions options;
+                    options.bestOfN = n;
+                    options.threads = thr;
+                    options.language = lang;
+                    options.gpu = gpu;
+
+                    std::vector<StageTimings> samples;
+                    double busy_ms = 0.0;
+                    for (int r = 0; r < runs; ++r) {
+                        for (const auto& clip : clips) {
+                            StageTimings t;
+                            processor.transcribe(clip.pcm, options, &t);
+                            busy_ms += t.total_ms;
+                            samples.push_back(t);
+                        }
+                    }
+
+                    const double rtf = busy_ms / 1000.0 / (corpus_seconds * runs);
+                    const double peak_mb = bench::peak_rss_bytes() / 1048576.0;
+                    std::cout << "\n" << name << " best_of=" << n << " threads=" << thr << " language=" << lang
+                              << std::fixed << std::setprecision(3) << ": RTF " << rtf
+                              << std::setprecision(0) << ", load " << load_ms << " ms, peak RSS " << peak_mb
+                              << " MB\n" << std::defaultfloat;
+                    std::cout << "  " << std::left << std::setw(12) << "stage (ms)" << std::right
+                              << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << "\n";
+
+                    const std::vector<std::pair<const char*, double StageTimings::*>> stages = {
+                        { "preprocess", &StageTimings::preprocess_ms },
+                        { "state", &StageTimings::state_ms },
+                        { "encode", &StageTimings::encode_ms },
+                        { "decode", &StageTimings::decode_ms },
+                        { "scoring", &StageTimings::scoring_ms },
+                        { "total", &StageTimings::total_ms },
+                    };
+                    std::ostringstream json_stages;
+                    for (const auto& stage : stages) {
+                        std::vector<double> v;
+                        for (const auto& t : samples) v.push_back(t.*stage.second);
+                        const double p50 = bench::percentile(v, 50), p95 = bench::percentile(v, 95),
+                                     p99 = bench::percentile(v, 99);
+                        std::cout << "  " << std::left << std::setw(12) << stage.first << std::right << std::fixed
+                                  << std::setprecision(1) << std::setw(10) << p50 << std::setw(10) << p95
+                                  << std::setw(10) << p99 << "\n" << std::defaultfloat;
+                        json_stages << (json_stages.tellp() > 0 ? "," : "") << json::quote(stage.first)
+                                    << ":{\"p50\":" << json::number(p50) << ",\"p95\":" << json::number(p95)
+                                    << ",\"p99\":" << json::number(p99) << "}";
+                    }
+
+                    if (json_out.is_open()) {
+                        json_out << "{\"model\":" << json::quote(name) << ",\"best_of\":" << n
+                                 << ",\"threads\":" << thr << ",\"language\":" << json::quote(lang)
+                                 << ",\"clips\":" << samples.size() << ",\"rtf\":" << json::number(rtf)
+                                 << ",\"load_ms\":" << json::number(load_ms)
+                                 << ",\"peak_rss_mb\":" << json::number(peak_mb)
+                                 << ",\"stages_ms\":{" << json_stages.str() << "}}\n";
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+// Task post/execute throughput of rose::Executor and rose::SerialQueue, with a
+// std::function + mutex queue as the baseline they replace.
+//
+//   rose_bench_executor [--tasks N] [--threads N]
+
+#include "BenchUtil.h"
+#include "Executor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+void report(const char* name, size_t tasks, double ms) {
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << ms << " ms"
+              << std::setprecision(2) << std::setw(10) << tasks / ms / 1000.0 << " Mtask/s"
+              << std::setprecision(1) << std::setw(10) << ms * 1e6 / tasks << " ns/task\n";
+}
+
+void wait_for(const std::atomic<size_t>& counter, size_t target) {
+    while (counter.load(std::memory_order_acquire) < target) std::this_thread::yield();
+}
+
+// Single consumer thread fed through a mutex-protected std::function queue.
+class FunctionQueue {
+public:
+    FunctionQueue() : worker_([this] { loop(); }) {}
+    ~FunctionQueue() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        worker_.join();
+    }
+    void async(std::function<void()> fn) {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            q_.push_back(std::move(fn));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    void loop() {
+        for (;;) {
+            std::function<void()> fn;
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                cv_.wait(lk, [this] { return stop_ || !q_.empty(); });
+                if (q_.empty()) return;
+                fn = std::move(q_.front());
+                q_.pop_front();
+            }
+            fn();
+        }
+    }
+
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> q_;
+    bool stop_ { false };
+    std::thread worker_;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t tasks = 1000000;
+    unsigned threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--tasks" && i + 1 < argc) tasks = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && i + 1 < argc) threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else {
+            std::cerr << "usage: rose_bench_executor [--tasks N] [--threads N]\n";
+            return 2;
+        }
+    }
+
+    rose::Executor pool(threads);
+    std::atomic<size_t> done{0};
+    // Typical capture: a few pointers and a value, well within the inline buffer.
+    size_t payload = 7;
+    auto typical = [&done, &payload, k = size_t{3}]() {
+        done.fetch_add((payload & k) ? 1 : 1, std::memory_order_relaxed);
+    };
+    std::cout << "threads=" << pool.threadCount() << " tasks=" << tasks
+              << " typical_lambda_inline=" << (rose::Task(typical).isInline() ? "yes" : "no") << "\n";
+
+    {
+        done = 0;
+        const auto t0 = bench::Clock::now();
+        for (size_t i = 0; i < tasks; ++i) pool.post(typical);
+        wait_for(done, tasks);
+        report("executor external post", tasks, bench::ms_since(t0));
+    }
+    {
+        // Fan-out from inside the pool lands on the worker's own deque; idle
+        // workers steal from it.
+        done = 0;
+        const auto t0 = bench::Clock::now();
+        pool.post([&] { for (size_t i = 0; i < tasks; ++i) pool.post(typical); });
+        wait_for(done, tasks);
+        report("executor worker fan-out", tasks, bench::ms_since(t0));
+    }
+    {
+        done = 0;
+        const auto t0 = bench::Clock::now();
+        rose::TaskGroup group(pool);
+        for (size_t i = 0; i < tasks; ++i) group.run(typical);
+        group.wait();
+        report("task group run+wait", tasks, bench::ms_since(t0));
+    }
+    {
+        done = 0;
+        rose::SerialQueue serial("bench.serial", pool);
+        const auto t0 = bench::Clock::now();
+        for (size_t i = 0; i < tasks; ++i) serial.async(typical);
+        wait_for(done, tasks);
+        report("serial queue", tasks, bench::ms_since(t0));
+    }
+    {
+        done = 0;
+        FunctionQueue baseline;
+        const auto t0 = bench::Clock::now();
+        for (size_t i = 0; i < tasks; ++i) baseline.async(typical);
+        wait_for(done, tasks);
+        report("std::function queue", tasks, bench::ms_since(t0));
+    }
+    return 0;
+}
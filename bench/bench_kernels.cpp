@@ -0,0 +1,246 @@
+// Per-sample cost of the preprocessing kernels and candidate selection across
+// clip lengths from half a second to ten minutes. Results can be saved as a
+// JSON baseline and later runs compared against it.
+//
+//   rose_bench [--sizes S,S,...] [--min-ms MS] [--json FILE]
+//              [--baseline FILE] [--threshold PCT]
+//
+// With --baseline the exit status is 1 when any case is slower than the
+// baseline by more than --threshold percent (default 10).
+
+#include "AudioUtils.h"
+#include "BenchUtil.h"
+#include "Constants.h"
+#include "Json.h"
+#include "TextScoring.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Result {
+    std::string kernel;
+    double seconds;         // clip length; candidate count for select_best
+    double ns_per_item;     // per sample, or per candidate
+    double gbps;            // input bytes processed per second
+};
+
+std::string case_name(const Result& r) {
+    std::ostringstream s;
+    s << r.kernel << "@" << r.seconds;
+    return s.str();
+}
+
+// Speech-like test signal: quiet lead-in and tail for trim_silence, then
+// noise-backed tone bursts with enough zero crossings to pass the VAD.
+std::vector<float> synthetic_clip(double seconds) {
+    const size_t n = static_cast<size_t>(seconds * constants::kSampleRate);
+    std::vector<float> out(n);
+    uint32_t seed = 0x2545f491u;
+    const size_t edge = n / 10;
+    for (size_t i = 0; i < n; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        const float noise = (static_cast<float>(seed >> 8) / static_cast<float>(1u << 24) - 0.5f) * 0.01f;
+        const bool voiced = i >= edge && i + edge < n && (i / 4000) % 3 != 2;
+        const float tone = voiced ? 0.3f * std::sin(static_cast<float>(i) * 0.07f) : 0.0f;
+        out[i] = (i < edge || i + edge >= n ? 0.0f : noise) + tone;
+    }
+    return out;
+}
+
+// Median over repetitions, repeating until `min_ms` has elapsed (at least 3).
+double median_ns(const std::function<void()>& fn, double min_ms) {
+    std::vector<double> samples;
+    const auto start = bench::Clock::now();
+    while (samples.size() < 3 || bench::ms_since(start) < min_ms) {
+        const auto t0 = bench::Clock::now();
+        fn();
+        samples.push_back(bench::ms_since(t0) * 1e6);
+        if (samples.size() >= 1000) break;
+    }
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+std::vector<double> parse_sizes(const std::string& list) {
+    std::vector<double> sizes;
+    std::stringstream in(list);
+    for (std::string item; std::getline(in, item, ',');) {
+        const double s = std::atof(item.c_str());
+        if (s > 0.0) sizes.push_back(s);
+    }
+    return sizes;
+}
+
+// Reads back what write_json() produced: one result object per line.
+std::map<std::string, double> read_baseline(const std::string& path) {
+    std::map<std::string, double> out;
+    std::ifstream in(path);
+    for (std::string line; std::getline(in, line);) {
+        const size_t k = line.find("\"kernel\":\"");
+        const size_t s = line.find("\"seconds\":");
+        const size_t v = line.find("\"ns_per_item\":");
+        if (k == std::string::npos || s == std::string::npos || v == std::string::npos) continue;
+        Result r;
+        r.kernel = line.substr(k + 10, line.find('"', k + 10) - (k + 10));
+        r.seconds = std::atof(line.c_str() + s + 10);
+        out[case_name(r)] = std::atof(line.c_str() + v + 14);
+    }
+    return out;
+}
+
+bool write_json(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "  {\"kernel\":" << json::quote(r.kernel) << ",\"seconds\":" << json::number(r.seconds)
+            << ",\"ns_per_item\":" << json::number(r.ns_per_item) << ",\"gbps\":" << json::number(r.gbps)
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<double> sizes = { 0.5, 2.0, 10.0, 60.0, 600.0 };
+    double min_ms = 200.0;
+    double threshold = 10.0;
+    std::string json_path;
+    std::string baseline_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) sizes = parse_sizes(argv[++i]);
+        else if (arg == "--min-ms" && i + 1 < argc) min_ms = std::atof(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc) json_path = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc) baseline_path = argv[++i];
+        else if (arg == "--threshold" && i + 1 < argc) threshold = std::atof(argv[++i]);
+        else {
+            std::cerr << "usage: rose_bench [--sizes S,S,...] [--min-ms MS] [--json FILE]"
+                         " [--baseline FILE] [--threshold PCT]\n";
+            return 2;
+        }
+    }
+
+    const int sr = constants::kSampleRate;
+    // Kernels return something derived from their output so none of the work
+    // can be discarded.
+    using Kernel = std::function<size_t(const std::vector<float>&)>;
+    const std::vector<std::pair<std::string, Kernel>> kernels = {
+        { "trim_silence", [sr](const std::vector<float>& a) {
+            return audio::trim_silence(a, sr, constants::kNormalizeMinAmp).size(); } },
+        { "apply_high_pass_filter", [sr](const std::vector<float>& a) {
+            return audio::apply_high_pass_filter(a, sr, constants::kHighPassCutoffHz).size(); } },
+        { "remove_noise", [](const std::vector<float>& a) {
+            return audio::remove_noise(a, constants::kNoiseWindowSize, constants::kNoiseFloorFactor,
+                                       constants::kNoiseAttenuation).size(); } },
+        { "normalize", [](const std::vector<float>& a) {
+            return audio::normalize(a, constants::kNormalizeMinAmp, constants::kNormalizeTargetAmp).size(); } },
+        { "detect_voice_activity", [](const std::vector<float>& a) {
+            return static_cast<size_t>(audio::detect_voice_activity(a, constants::kVADMinEnergy,
+                                                                    constants::kVADZcrMin,
+                                                                    constants::kVADZcrMax)); } },
+        { "preprocess", [sr](const std::vector<float>& a) {
+            return audio::preprocess(a, sr, constants::kHighPassCutoffHz, constants::kNoiseWindowSize,
+                                     constants::kNoiseFloorFactor, constants::kNoiseAttenuation,
+                                     constants::kNormalizeMinAmp, constants::kNormalizeTargetAmp).size(); } },
+    };
+
+    std::vector<Result> results;
+    std::cout << std::left << std::setw(26) << "kernel" << std::right << std::setw(10) << "input"
+              << std::setw(14) << "median ms" << std::setw(12) << "ns/item" << std::setw(10) << "GB/s" << "\n";
+    auto report = [&](const Result& r, const char* unit, double ms) {
+        std::ostringstream input;
+        input << r.seconds << unit;
+        std::cout << std::left << std::setw(26) << r.kernel << std::right << std::setw(10) << input.str()
+                  << std::fixed << std::setprecision(3) << std::setw(14) << ms
+                  << std::setprecision(2) << std::setw(12) << r.ns_per_item
+                  << std::setprecision(2) << std::setw(10) << r.gbps << "\n" << std::defaultfloat;
+        results.push_back(r);
+    };
+
+    volatile size_t sink = 0;
+    for (double seconds : sizes) {
+        const std::vector<float> clip = synthetic_clip(seconds);
+        const double bytes = static_cast<double>(clip.size() * sizeof(float));
+        for (const auto& k : kernels) {
+            const double ns = median_ns([&] { sink = sink + k.second(clip); }, min_ms);
+            report(Result{ k.first, seconds, ns / clip.size(), bytes / ns }, " s", ns / 1e6);
+        }
+    }
+
+    // Capture conversion: int16 ring to float with auto-gain and clamp, the
+    // work getAudioData() does per recording. Bytes are the int16 input.
+    for (double seconds : sizes) {
+        const std::vector<float> clip = synthetic_clip(seconds);
+        std::vector<int16_t> pcm(clip.size());
+        for (size_t i = 0; i < clip.size(); ++i) pcm[i] = static_cast<int16_t>(clip[i] * 32767.0f);
+        std::vector<float> out(pcm.size());
+        const double bytes = static_cast<double>(pcm.size() * sizeof(int16_t));
+        double ns = median_ns([&] { sink = sink + static_cast<size_t>(audio::peak_int16(pcm.data(), pcm.size())); }, min_ms);
+        report(Result{ "peak_int16", seconds, ns / pcm.size(), bytes / ns }, " s", ns / 1e6);
+        ns = median_ns([&] {
+            audio::int16_to_float(pcm.data(), pcm.size(), 2.0f, out.data());
+            sink = sink + static_cast<size_t>(out[out.size() / 2] > 0.0f);
+        }, min_ms);
+        report(Result{ "int16_to_float", seconds, ns / pcm.size(), bytes / ns }, " s", ns / 1e6);
+    }
+
+    // select_best over typical candidate counts; ns per candidate.
+    for (int n : { constants::kBestOfNDefault, constants::kBestOfNMax }) {
+        std::vector<TranscriptionResult> candidates;
+        for (int i = 0; i < n; ++i) {
+            TranscriptionResult r{ "the quick brown fox", -0.1f * i, 0.05f * i, 0.0f };
+            r.score = textscore::score(r);
+            candidates.push_back(r);
+        }
+        constexpr int kCalls = 10000;
+        volatile float best = 0.0f;
+        const double ns = median_ns([&] {
+            for (int c = 0; c < kCalls; ++c) best = best + textscore::select_best(candidates).score;
+        }, min_ms) / kCalls;
+        const double bytes = static_cast<double>(n * sizeof(TranscriptionResult));
+        report(Result{ "select_best", static_cast<double>(n), ns / n, bytes / ns }, " cand", ns / 1e6);
+    }
+
+    if (!json_path.empty() && !write_json(json_path, results)) {
+        std::cerr << "cannot write " << json_path << "\n";
+        return 2;
+    }
+
+    if (baseline_path.empty()) return 0;
+    const auto baseline = read_baseline(baseline_path);
+    if (baseline.empty()) {
+        std::cerr << "no results in baseline " << baseline_path << "\n";
+        return 2;
+    }
+    int regressions = 0;
+    std::cout << "\ncompared with " << baseline_path << " (threshold " << threshold << "%):\n";
+    for (const auto& r : results) {
+        const auto it = baseline.find(case_name(r));
+        if (it == baseline.end() || it->second <= 0.0) continue;
+        const double change = (r.ns_per_item / it->second - 1.0) * 100.0;
+        const bool regressed = change > threshold;
+        regressions += regressed ? 1 : 0;
+        std::ostringstream delta;
+        delta << std::fixed << std::setprecision(1) << (change >= 0.0 ? "+" : "") << change << "%";
+        std::cout << (regressed ? "  REGRESSION " : "             ") << std::left << std::setw(32)
+                  << case_name(r) << std::right << std::setw(9) << delta.str() << "\n";
+    }
+    std::cout << regressions << " regression" << (regressions == 1 ? "" : "s") << "\n";
+    return regressions > 0 ? 1 : 0;
+}
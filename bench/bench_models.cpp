@@ -0,0 +1,134 @@
+// Reports load time, RSS and real-time factor for every model variant on disk.
+//
+//   rose_bench_models [--wav clip.wav] [--threads N] [--runs N] [--family small]
+
+#include "AudioFile.h"
+#include "BenchUtil.h"
+#include "Constants.h"
+#include "ModelCatalog.h"
+#include "WhisperContext.h"
+#include "whisper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Voiced-ish synthetic clip used when no WAV is given: harmonic bursts over noise.
+std::vector<float> synthetic_clip(int seconds) {
+    std::vector<float> x(static_cast<size_t>(seconds) * constants::kSampleRate);
+    uint32_t seed = 12345u;
+    for (size_t i = 0; i < x.size(); ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        const float noise = (static_cast<float>(seed >> 8) / static_cast<float>(1u << 24) - 0.5f) * 0.01f;
+        const float t = static_cast<float>(i) / constants::kSampleRate;
+        const float env = std::fmod(t, 1.0f) < 0.6f ? 1.0f : 0.0f;
+        x[i] = noise + env * 0.2f * (std::sin(2.0f * static_cast<float>(M_PI) * 180.0f * t) +
+                                     0.5f * std::sin(2.0f * static_cast<float>(M_PI) * 360.0f * t));
+    }
+    return x;
+}
+
+double decode_once(WhisperContext& ctx, const std::vector<float>& pcm, int threads) {
+    auto state = ctx.acquireState();
+    if (!state) return -1.0;
+    whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    params.print_progress = false;
+    params.print_special = false;
+    params.print_realtime = false;
+    params.print_timestamps = false;
+    params.language = "en";
+    params.n_threads = threads;
+    const auto t0 = bench::Clock::now();
+    if (whisper_full_with_state(ctx.get(), state.get(), params, pcm.data(), static_cast<int>(pcm.size())) != 0) {
+        return -1.0;
+    }
+    return bench::ms_since(t0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string wav;
+    std::string family;
+    int threads = constants::kWhisperThreads;
+    int runs = 3;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--wav" && i + 1 < argc) wav = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--runs" && i + 1 < argc) runs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--family" && i + 1 < argc) family = argv[++i];
+        else {
+            std::cerr << "usage: rose_bench_models [--wav clip.wav] [--threads N] [--runs N] [--family NAME]\n";
+            return 2;
+        }
+    }
+
+    std::vector<float> pcm;
+    if (!wav.empty()) {
+        std::string err;
+        if (!audio::load_wav(wav, constants::kSampleRate, pcm, &err)) {
+            std::cerr << "[rose] " << err << "\n";
+            return 1;
+        }
+    } else {
+        pcm = synthetic_clip(10);
+    }
+    const double audio_ms = 1000.0 * pcm.size() / constants::kSampleRate;
+
+    std::vector<models::ModelFile> found;
+    for (const auto& dir : models::search_directories()) {
+        auto more = models::discover(dir);
+        found.insert(found.end(), more.begin(), more.end());
+    }
+    if (!family.empty()) {
+        found.erase(std::remove_if(found.begin(), found.end(), [&](const models::ModelFile& m) {
+            return models::size_family(m.size) != family;
+        }), found.end());
+    }
+    if (found.empty()) {
+        std::cerr << "[rose] no models found\n";
+        return 1;
+    }
+
+    const bool gpu = models::gpu_backend();
+    std::cout << "backend=" << (gpu ? "gpu" : "cpu") << " threads=" << threads
+              << " audio=" << audio_ms / 1000.0 << "s runs=" << runs << "\n";
+    std::cout << std::left << std::setw(34) << "model" << std::right
+              << std::setw(10) << "size_mb" << std::setw(10) << "load_ms"
+              << std::setw(10) << "rss_mb" << std::setw(12) << "decode_ms" << std::setw(8) << "rtf" << "\n";
+
+    for (const auto& m : found) {
+        const size_t rss_before = bench::current_rss_bytes();
+        WhisperContext ctx;
+        const auto t0 = bench::Clock::now();
+        if (!ctx.initialize(m.path, gpu)) {
+            std::cout << m.path << ": load failed\n";
+            continue;
+        }
+        const double load_ms = bench::ms_since(t0);
+
+        // First decode pays one-time costs; report the median of the steady runs.
+        decode_once(ctx, pcm, threads);
+        std::vector<double> times;
+        for (int r = 0; r < runs; ++r) times.push_back(decode_once(ctx, pcm, threads));
+        std::sort(times.begin(), times.end());
+        const double decode_ms = times[times.size() / 2];
+        const size_t rss = bench::current_rss_bytes();
+
+        const std::string name = m.size + (m.english_only ? ".en" : "") + " " + models::quantization_name(m.quant);
+        std::cout << std::left << std::setw(34) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << m.bytes / 1048576.0
+                  << std::setw(10) << load_ms
+                  << std::setw(10) << (rss > rss_before ? rss - rss_before : 0) / 1048576.0
+                  << std::setw(12) << decode_ms
+                  << std::setprecision(3) << std::setw(8) << decode_ms / audio_ms << "\n";
+    }
+    return 0;
+}
@@ -9,12 +9,14 @@ git submodule update --init --recursive
 mkdir -p build
 cd build
 cmake ..
-make -j$(sysctl -n hw.ncpu)
+make -j$(sysctl -n hw.ncpu 2>/dev/null || nproc)
 
 if [ $? -eq 0 ]; then
     echo "Build successful!"
     echo "To run (GUI): open ./build/Rose.app"
     echo "To run with logs: ./build/Rose.app/Contents/MacOS/Rose"
+    echo "Batch transcription: ./build/rose-cli --help"
+    echo "Transcription server: ./build/rose-daemon --help"
 else
     echo "Build failed!"
     exit 1
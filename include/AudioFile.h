@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace audio {
+
+// Loads a RIFF/WAVE file (PCM 8/16/24/32-bit or 32-bit float), downmixed to
+// mono and resampled to `sample_rate`. On failure returns false and fills
+// `error` when given.
+bool load_wav(const std::string& path,
+              int sample_rate,
+              std::vector<float>& out,
+              std::string* error = nullptr);
+
+// Same as load_wav for a WAV file already in memory.
+bool decode_wav(const unsigned char* bytes,
+                size_t size,
+                int sample_rate,
+                std::vector<float>& out,
+                std::string* error = nullptr);
+
+std::vector<float> resample_linear(const std::vector<float>& audio,
+                                   int from_rate,
+                                   int to_rate);
+
+} // namespace audio
@@ -2,11 +2,16 @@
 
 #include <vector>
 #include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <string>
 #include <portaudio.h>
 #include "Constants.h"
+#include "SpillStore.h"
 
 struct AudioDevice {
     int id;
@@ -24,6 +29,18 @@ public:
     void stopRecording();
     bool isRecording() const { return recording.load(); }
     std::vector<float> getAudioData();
+    // A recording that outgrew the ring was spilled to disk; take it here
+    // (sealed, ready to read) instead of from getAudioData(), which is then
+    // empty. Null for ordinary recordings.
+    std::unique_ptr<audio::SpillStore> takeSpilledCapture();
+
+    // Auto stop: with silenceMs > 0, each recording is watched for speech
+    // followed by that much silence. onEndpoint then runs on the watcher
+    // thread; it must not block or call stopRecording() itself. The capture
+    // is cut shortly after the last speech. Takes effect from the next start.
+    void setEndpointing(int silenceMs, std::function<void()> onEndpoint);
+    // True once the current (or just stopped) recording reached its endpoint.
+    bool endpointReached() const { return endpointed_.load(); }
 
     static std::vector<AudioDevice> getInputDevices();
 
@@ -33,15 +50,42 @@ private:
                            const PaStreamCallbackTimeInfo* timeInfo,
                            PaStreamCallbackFlags statusFlags,
                            void* userData);
+    void endpointLoop(int silenceMs);
+    void spillLoop();
+    // Moves ring samples up to total_written_ position `end` into spill_,
+    // zero-filling any the ring already overwrote so positions stay aligned.
+    bool spillUpTo(size_t end);
 
     PaStream* stream;
+    // Exactly one ring is allocated, by the sample format the stream opened with.
+    bool int16_ = false;
+    std::vector<int16_t> ring16_;
     std::vector<float> ringBuffer_;
     std::atomic<size_t> write_index_{0};
     std::atomic<size_t> total_written_{0};
     std::atomic<bool> recording;
     size_t capacity_ { 0 };
+    std::vector<int16_t> last_capture16_;
     std::vector<float> last_capture_;
     std::mutex prepare_mutex_;
+
+    std::atomic<int> endpoint_ms_ { constants::kEndpointOff };
+    std::function<void()> on_endpoint_;
+    std::thread endpoint_thread_;
+    std::mutex endpoint_mutex_;
+    std::condition_variable endpoint_cv_;
+    std::atomic<bool> endpointed_ { false };
+    size_t endpoint_end_ = 0;       // total_written_ position of the last speech
+
+    std::thread spill_thread_;
+    std::mutex spill_mutex_;
+    std::condition_variable spill_cv_;
+    std::atomic<bool> spilling_ { false };      // ring wraps are expected, not drops
+    std::unique_ptr<audio::SpillStore> spill_;  // this recording's, once it is long
+    size_t spilled_ = 0;                        // total_written_ position spilled so far
+    bool spill_stopped_ = false;                // store full or failing; nothing more spilled
+    std::vector<int16_t> spill_scratch_;
+    std::unique_ptr<audio::SpillStore> last_spill_;
     static constexpr int sampleRate = constants::kSampleRate;
     static constexpr int channels = constants::kChannels;
     static constexpr int framesPerBuffer = constants::kFramesPerBuffer;
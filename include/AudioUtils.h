@@ -1,5 +1,8 @@
 ﻿#pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 #include <vector>
 
 namespace audio {
@@ -22,10 +25,51 @@ bool detect_voice_activity(const std::vector<float>& audio,
                            float zcr_min,
                            float zcr_max);
 
+// Largest |sample| of 16-bit PCM, up to 32768.
+int peak_int16(const int16_t* in, size_t n);
+
+// out[i] = clamp(in[i] / 32768 * gain, -1, 1): capture conversion, auto-gain
+// and clamp in one pass. NEON or SSE2 where available, scalar otherwise.
+void int16_to_float(const int16_t* in, size_t n, float gain, float* out);
+
+// Rounds [-1, 1] floats to int16 (clamped), for spilling a float capture.
+void float_to_int16(const float* in, size_t n, int16_t* out);
+
 std::vector<float> trim_silence(const std::vector<float>& audio,
                                 int sample_rate,
                                 float rms_threshold);
 
+// Maps sample positions in compacted audio back to the original recording.
+// Empty means nothing was cut and positions map to themselves.
+class OffsetMap {
+public:
+    // Compacted samples from `compacted` on continue at `original`.
+    void add(size_t compacted, size_t original) { anchors_.emplace_back(compacted, original); }
+    size_t original(size_t compacted) const;
+    int64_t originalMs(int64_t compacted_ms, int sample_rate) const;
+    bool empty() const { return anchors_.empty(); }
+
+private:
+    std::vector<std::pair<size_t, size_t>> anchors_;   // ascending on both
+};
+
+struct Compacted {
+    std::vector<float> audio;   // empty when nothing was cut
+    OffsetMap offsets;
+};
+
+// Shortens interior pauses. Frames of `frame_ms` are quiet when their RMS is
+// under both `quiet_rms` and `relative_rms` times the loudest frame's; a quiet
+// run longer than `min_pause_ms` keeps `keep_ms` of it, half on each side.
+// Leading and trailing silence is left to trim_silence.
+Compacted compact_pauses(const std::vector<float>& audio,
+                         int sample_rate,
+                         int frame_ms,
+                         int min_pause_ms,
+                         int keep_ms,
+                         float relative_rms,
+                         float quiet_rms);
+
 std::vector<float> preprocess(const std::vector<float>& audio,
                               int sample_rate,
                               float hp_cutoff_hz,
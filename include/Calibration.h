@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace calibration {
+
+// Throughput of one model file at one thread count on this machine.
+struct ModelProfile {
+    std::string family;              // "tiny", "base", ... (Settings::modelFamily)
+    int threads = 0;
+    double encode_ms = 0.0;          // one full 30 s encoder window
+    double decode_ms_per_token = 0.0;
+};
+
+struct Choice {
+    std::string family;
+    int threads = 0;
+    double predicted_ms = 0.0;
+    bool meets_target = false;
+};
+
+// Predicted stop-to-text latency of one dictation decoded by `candidates`
+// concurrent decoders sharing `hw_threads` cores.
+double predict_ms(const ModelProfile& p, int candidates, unsigned hw_threads);
+
+// Largest model (by family order tiny..large) and thread split whose predicted
+// latency meets `target_ms`; falls back to the fastest profile. Returns false
+// when `profiles` is empty.
+bool choose(const std::vector<ModelProfile>& profiles,
+            double target_ms,
+            int candidates,
+            unsigned hw_threads,
+            Choice& out);
+
+// "family,threads,encode_ms,decode_ms_per_token" for the settings file.
+std::string serialize(const ModelProfile& p);
+bool parse(const std::string& line, ModelProfile& out);
+
+// Thread counts worth measuring: powers of two up to the core count, plus it.
+std::vector<int> thread_candidates(unsigned hw_threads);
+
+// Loads each model and measures encoder and decoder throughput. Runs for
+// seconds to minutes; call it off the UI thread. `progress` gets one line per
+// measurement.
+std::vector<ModelProfile> run(const std::vector<std::pair<std::string, std::string>>& family_paths,
+                              bool use_gpu,
+                              const std::function<void(const std::string&)>& progress);
+
+} // namespace calibration
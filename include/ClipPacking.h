@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TextScoring.h"
+
+// Several short clips decoded as one whisper window. Each window costs one
+// encoder pass whatever its length, so clips of a few seconds packed together
+// run several times faster than decoded one by one.
+namespace packing {
+
+// Where one input clip sits inside a packed window.
+struct Span {
+    size_t clip;        // index into the clips passed to pack()
+    int64_t start_ms;
+    int64_t end_ms;
+};
+
+struct Window {
+    std::vector<float> audio;
+    std::vector<Span> spans;
+};
+
+// Greedy in input order: consecutive clips share a window, separated by
+// `gap_ms` of silence, until the next would overflow `window_ms` or
+// `max_clips` is reached. A clip longer than the window gets one to itself.
+// Empty clips are skipped and appear in no span.
+std::vector<Window> pack(const std::vector<std::vector<float>>& clips,
+                         int sample_rate,
+                         int window_ms,
+                         int gap_ms,
+                         size_t max_clips);
+
+// Text of each span, in span order, from the window's segments. A segment
+// goes to the span it overlaps most, or the nearest one if it overlaps none.
+std::vector<std::string> split(const std::vector<TranscriptSegment>& segments,
+                               const std::vector<Span>& spans);
+
+} // namespace packing
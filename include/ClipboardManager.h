@@ -1,8 +1,25 @@
 #pragma once
 
+#include <mutex>
 #include <string>
+#include "OutputSink.h"
 
 class ClipboardManager {
 public:
     static void copyToClipboard(const std::string& text);
-};
\ No newline at end of file
+    static std::string readClipboard();
+};
+
+// The clipboard as an output sink: partial text replaces the clipboard as it
+// arrives. If a dictation that showed partials ends up empty, what was on the
+// clipboard before its first partial is put back.
+class ClipboardSink : public rose::OutputSink {
+public:
+    void partial(int seq, const std::string& text) override;
+    void commit(int seq, const std::string& text) override;
+
+private:
+    std::mutex mutex_;
+    int seq_ = -1;          // dictation whose partials are on the clipboard
+    std::string saved_;     // clipboard before them
+};
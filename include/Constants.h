@@ -10,6 +10,21 @@ inline constexpr int kSampleRate = 16000;
 inline constexpr int kChannels = 1;
 inline constexpr int kFramesPerBuffer = 2048;
 inline constexpr int kMaxRecordingSeconds = 30;
+// Long recordings: past kSpillStartSeconds (before the ring wraps) the capture
+// is spilled to a temporary file in kSpillChunkSeconds chunks, the ring
+// keeping only the hot tail, up to kSpillMaxSeconds in all. The result is
+// decoded in chunks of at most kSpillDecodeSeconds, each cut at the quietest
+// point of its last kSpillCutSearchSeconds.
+inline constexpr int kSpillStartSeconds = 20;
+inline constexpr int kSpillChunkSeconds = 5;
+inline constexpr int kSpillPollMs = 250;
+inline constexpr int kSpillMaxSeconds = 8 * 3600;
+inline constexpr int kSpillDecodeSeconds = 28;
+inline constexpr int kSpillCutSearchSeconds = 3;
+
+// Capture 16-bit samples (half the ring memory and bandwidth of float32);
+// a device that refuses int16 falls back to float32.
+inline constexpr bool kCaptureInt16 = true;
 
 inline constexpr float kAutoGainThreshold = 0.5f;
 inline constexpr float kAutoGainTarget = 0.8f;
@@ -32,14 +47,144 @@ inline constexpr bool kUseGPU = true;
 inline constexpr float kWhisperMaxInitialTs = 1.0f;
 inline constexpr float kWhisperEntropyThold = 2.4f;
 inline constexpr float kWhisperLogprobThold = -1.0f;
+inline constexpr int kWhisperWindowSeconds = 30;   // audio the encoder sees in one pass
+
+// Runaway guard: a candidate that samples more than kRunawayTokenSlack plus
+// kRunawayTokensPerSecond of audio tokens, or whose committed text ends in
+// one n-gram (up to kRepeatMaxNgram words) repeated kRepeatMinRepeats times
+// and covering kRepeatMinWords, is looping; it is aborted and ranked last.
+inline constexpr int kRunawayTokensPerSecond = 12;
+inline constexpr int kRunawayTokenSlack = 48;
+inline constexpr int kRepeatMaxNgram = 8;
+inline constexpr int kRepeatMinRepeats = 3;
+inline constexpr int kRepeatMinWords = 12;
+
+// Post-load warm-up: one short synthetic decode primes kernels and compute buffers
+inline constexpr bool kWarmupEnabled = true;
+inline constexpr int kWarmupSamples = kSampleRate;
+inline constexpr int kWarmupMaxTokens = 4;
+
+// Auto language: detected once per clip and shared by every candidate. After
+// kLanguageSessionHits confident detections of one language in a row, later
+// clips reuse it; a decode below kLanguageRecheckLogprob re-checks.
+inline constexpr int kLanguageSessionHits = 3;
+inline constexpr float kLanguageConfidentProb = 0.8f;
+inline constexpr float kLanguageRecheckLogprob = -1.0f;
+
+// No-speech probe: one encoder pass and one decoder step decide whether a clip
+// is silent before any candidate starts. Run for auto language (the pass is
+// shared with detection) or when at least this many candidates would decode.
+inline constexpr int kNoSpeechProbeMinCandidates = 2;
+
+// Pause compaction: interior pauses longer than kPauseMinMs are cut down to
+// kPauseKeepMs before decoding, and timestamps are mapped back afterwards.
+// A frame is quiet under both kPauseQuietRms and kPauseRelativeRms times the
+// clip's loudest frame.
+inline constexpr int kPauseFrameMs = 20;
+inline constexpr int kPauseMinMs = 700;
+inline constexpr int kPauseKeepMs = 300;
+inline constexpr float kPauseQuietRms = 0.02f;
+inline constexpr float kPauseRelativeRms = 0.05f;
 
 // Enable extra debug logs for troubleshooting (prints preprocessing + VAD stats)
 inline constexpr bool kDebugLogging = false;
 
+// Dictations allowed in each pipeline stage (queued plus running)
+inline constexpr size_t kPipelineStageCapacity = 2;
+
+// rose-daemon scheduling: clips at most kDaemonShortClipSeconds long that
+// arrive within kDaemonBatchWindowMs of each other are dispatched together,
+// up to kDaemonMaxBatch per batch. A client with kDaemonMaxQueuedPerClient
+// requests waiting gets "busy" instead of queueing more.
+inline constexpr double kDaemonShortClipSeconds = 10.0;
+inline constexpr int kDaemonBatchWindowMs = 8;
+inline constexpr size_t kDaemonMaxBatch = 4;
+inline constexpr size_t kDaemonMaxQueuedPerClient = 32;
+
+// Clip packing: short clips share one encoder window, each followed by a
+// silence gap so whisper ends a segment between them. The window keeps some
+// slack under whisper's 30 s so a clip never straddles two windows. Packed
+// windows skip pause compaction, which would shorten the gaps.
+inline constexpr int kPackWindowMs = 28000;
+inline constexpr int kPackGapMs = 800;
+inline constexpr size_t kPackMaxClips = 8;
+
+// Transcript cache (rose-cli/rose-daemon --cache) size cap before compaction
+inline constexpr size_t kCacheDefaultMaxMB = 256;
+
+// Tracing: events kept per thread (oldest overwritten) and the environment
+// variable that turns tracing on at launch.
+inline constexpr size_t kTraceRingEvents = 8192;
+inline constexpr const char* kTraceEnvVar = "ROSE_TRACE";
+
+// Metrics: Prometheus text file rewrite interval, and the environment variable
+// naming that file for the app (rose-cli/rose-daemon take --metrics FILE).
+inline constexpr int kMetricsWriteIntervalMs = 15000;
+inline constexpr const char* kMetricsEnvVar = "ROSE_METRICS";
+
+// Names a file the app keeps holding the current dictation's text, updated
+// segment by segment like the clipboard.
+inline constexpr const char* kTranscriptEnvVar = "ROSE_TRANSCRIPT";
+
 inline constexpr int kBestOfNMin = 1;
 inline constexpr int kBestOfNDefault = 5;
 inline constexpr int kBestOfNMax = 10;
 
+// Hardware calibration: thread counts measured, decoder steps timed, and the
+// token count of a typical dictation used to predict latency.
+inline constexpr int kCalibrationMaxThreads = 16;
+inline constexpr int kCalibrationDecodeSteps = 16;
+inline constexpr int kCalibrationExpectedTokens = 48;
+
+inline constexpr int kLatencyTargetOff = 0;
+// With a latency target set, dictation decodes are cut off at this multiple
+// of it and the best result available by then is used.
+inline constexpr double kDeadlineTargetMultiple = 2.0;
+
+inline const std::vector<std::pair<int, std::string>>& LatencyTargetOptions() {
+    static const std::vector<std::pair<int, std::string>> opts = {
+        {kLatencyTargetOff, "Off (Use Model Menu)"},
+        {500, "0.5 s"},
+        {1000, "1 s"},
+        {2000, "2 s"},
+        {4000, "4 s"},
+    };
+    return opts;
+}
+
+// Endpointing (auto stop): recording ends by itself after this much silence
+// following speech. Frames are speech when their energy clears both an
+// absolute floor and a multiple of the tracked background noise.
+inline constexpr int kEndpointOff = 0;
+inline constexpr int kEndpointFrameMs = 20;
+inline constexpr int kEndpointMinSpeechMs = 200;   // heard before a pause can end the clip
+inline constexpr int kEndpointTailMs = 250;        // kept after the last speech frame
+inline constexpr int kEndpointPollMs = 30;
+inline constexpr float kEndpointMinEnergy = 1e-5f;
+inline constexpr float kEndpointSpeechRatio = 4.0f;
+inline constexpr float kEndpointFloorRise = 1.005f; // per frame; the floor falls at once
+
+inline const std::vector<std::pair<int, std::string>>& EndpointOptions() {
+    static const std::vector<std::pair<int, std::string>> opts = {
+        {kEndpointOff, "Off (Hotkey Stops)"},
+        {500, "0.5 s Pause"},
+        {800, "0.8 s Pause"},
+        {1200, "1.2 s Pause"},
+        {2000, "2 s Pause"},
+    };
+    return opts;
+}
+
+// Thread scheduling (Linux; macOS uses QoS classes). The audio thread asks for
+// SCHED_FIFO at this priority, falling back to this nice value when not
+// privileged. kDecodeCpusEnvVar ("0-3,6") overrides the decode CPU set.
+inline constexpr int kAudioRealtimePriority = 70;
+inline constexpr int kAudioNice = -10;
+inline constexpr const char* kDecodeCpusEnvVar = "ROSE_DECODE_CPUS";
+
+// Settings changes are written to disk once they have been quiet this long.
+inline constexpr int kSettingsSaveDebounceMs = 500;
+
 inline constexpr int kRetainSecondsMin = 0;
 inline constexpr int kRetainSecondsDefault = 10;
 inline constexpr int kRetainSecondsMax = 120;
@@ -73,6 +218,19 @@ inline const std::vector<std::string>& ModelFallbacks() {
     return models;
 }
 
+inline const std::string kDefaultQuantization = "auto";
+
+inline const std::vector<std::pair<std::string, std::string>>& QuantizationOptions() {
+    static const std::vector<std::pair<std::string, std::string>> opts = {
+        {"auto", "Auto (by Backend)"},
+        {"f16", "F16 (Full Precision)"},
+        {"q8_0", "Q8_0"},
+        {"q5_1", "Q5_1"},
+        {"q5_0", "Q5_0 (Smallest)"},
+    };
+    return opts;
+}
+
 inline const std::vector<std::pair<std::string, std::string>>& LanguageOptions() {
     static const std::vector<std::pair<std::string, std::string>> langs = {
         {"auto", "Auto Detect"},
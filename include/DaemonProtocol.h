@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Wire format spoken by rose-daemon over its Unix domain socket. Every message
+// is a fixed little-endian header followed by `payload_bytes` of payload.
+//
+//   request  (32 bytes): "ROSE" u16 version, u16 format, u32 sample_rate,
+//                        u16 best_of, u16 reserved, char language[8],
+//                        u32 request_id, u32 payload_bytes
+//   response (16 bytes): "ROSE" u16 version, u16 status,
+//                        u32 request_id, u32 payload_bytes
+//
+// The request payload is mono PCM (float32 or int16) at `sample_rate`, or a
+// complete WAV file. The response payload is one JSON object. A client may
+// pipeline several requests on one connection; responses carry the request id
+// and may complete out of order.
+namespace ipc {
+
+inline constexpr uint16_t kVersion = 1;
+inline constexpr size_t kRequestHeaderSize = 32;
+inline constexpr size_t kResponseHeaderSize = 16;
+inline constexpr uint32_t kMaxPayloadBytes = 64u << 20;
+
+enum class AudioFormat : uint16_t { PcmF32 = 1, PcmS16 = 2, Wav = 3 };
+enum class Status : uint16_t { Ok = 0, BadRequest = 1, DecodeFailed = 2, Busy = 3, Unavailable = 4 };
+
+struct Request {
+    uint32_t id = 0;
+    AudioFormat format = AudioFormat::PcmF32;
+    uint32_t sample_rate = 0;   // 0 = 16 kHz; ignored for WAV
+    uint16_t best_of = 0;       // 0 = server default
+    std::string language;       // empty = server default, at most 8 bytes
+    std::vector<unsigned char> payload;
+};
+
+struct Response {
+    uint32_t id = 0;
+    Status status = Status::Ok;
+    std::string body;
+};
+
+const char* status_name(Status status);
+
+std::vector<unsigned char> encode_request(const Request& request);
+std::vector<unsigned char> encode_response(const Response& response);
+// Parse a header; the payload is read separately. False on bad magic,
+// version, format or size.
+bool decode_request_header(const unsigned char* header, Request& out, uint32_t& payload_bytes,
+                           std::string* error = nullptr);
+bool decode_response_header(const unsigned char* header, Response& out, uint32_t& payload_bytes,
+                            std::string* error = nullptr);
+
+// Request payload as mono float samples at `sample_rate`.
+bool decode_audio(const Request& request, int sample_rate, std::vector<float>& out,
+                  std::string* error = nullptr);
+
+// Blocking whole-message IO; false on EOF or error.
+bool read_request(int fd, Request& out, std::string* error = nullptr);
+bool read_response(int fd, Response& out, std::string* error = nullptr);
+bool write_message(int fd, const std::vector<unsigned char>& bytes);
+
+// $XDG_RUNTIME_DIR/rose.sock, else /tmp/rose-<uid>.sock.
+std::string default_socket_path();
+// Bound and listening socket (a stale socket file is replaced), or -1.
+int listen_unix(const std::string& path, std::string* error = nullptr);
+int connect_unix(const std::string& path, std::string* error = nullptr);
+
+} // namespace ipc
@@ -1,8 +1,11 @@
 #pragma once
 
+// libdispatch adapter for macOS. Portable code posts to rose::SerialQueue /
+// rose::Executor (Executor.h); this stays for main-thread hops into AppKit.
+
 #include <dispatch/dispatch.h>
-#include <functional>
 #include <string>
+#include "Executor.h"
 
 class DispatchQueue {
 public:
@@ -15,26 +18,22 @@ public:
     DispatchQueue(const DispatchQueue&) = delete;
     DispatchQueue& operator=(const DispatchQueue&) = delete;
 
-    void async(std::function<void()> fn) const {
-        auto heap_fn = new std::function<void()>(std::move(fn));
-        dispatch_async_f(q_, heap_fn, [](void* ctx){
-            auto f = static_cast<std::function<void()>*>(ctx);
-            (*f)();
-            delete f;
-        });
+    void async(rose::Task fn) const {
+        dispatch_async_f(q_, new rose::Task(std::move(fn)), &DispatchQueue::invoke);
     }
 
-    static void main_async(std::function<void()> fn) {
-        auto heap_fn = new std::function<void()>(std::move(fn));
-        dispatch_async_f(dispatch_get_main_queue(), heap_fn, [](void* ctx){
-            auto f = static_cast<std::function<void()>*>(ctx);
-            (*f)();
-            delete f;
-        });
+    static void main_async(rose::Task fn) {
+        dispatch_async_f(dispatch_get_main_queue(), new rose::Task(std::move(fn)), &DispatchQueue::invoke);
     }
 
     dispatch_queue_t native() const { return q_; }
 
 private:
+    static void invoke(void* ctx) {
+        auto f = static_cast<rose::Task*>(ctx);
+        (*f)();
+        delete f;
+    }
+
     dispatch_queue_t q_ { nullptr };
 };
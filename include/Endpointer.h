@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+namespace audio {
+
+// Streaming end-of-utterance detector. Samples arrive in any chunking and are
+// scored in fixed frames by mean-square energy against a noise floor that
+// follows the quietest frames. Once enough speech has been heard, a run of
+// `silence_ms` quiet frames is the endpoint. No allocation after construction.
+class Endpointer {
+public:
+    Endpointer(int sample_rate, int silence_ms);
+
+    // True from the frame that completes the endpoint on.
+    bool push(const float* samples, size_t count);
+    bool fired() const { return fired_; }
+    // Samples consumed up to the end of the last speech frame.
+    size_t speechEnd() const { return speech_end_; }
+    void reset();
+
+private:
+    void endFrame();
+
+    const size_t frame_len_;
+    const int silence_frames_;
+    const int min_speech_frames_;
+
+    double energy_ = 0.0;       // sum of squares in the current frame
+    size_t in_frame_ = 0;
+    size_t consumed_ = 0;
+    float floor_ = 0.0f;        // 0 until the first frame
+    int speech_frames_ = 0;
+    int silence_run_ = 0;
+    size_t speech_end_ = 0;
+    bool fired_ = false;
+};
+
+} // namespace audio
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "ThreadPolicy.h"
+
+namespace rose {
+
+// Move-only callable. Callables up to kInlineSize bytes (a lambda capturing a
+// handful of pointers or references) are stored inline and never allocate.
+class Task {
+public:
+    static constexpr size_t kInlineSize = 48;
+
+    Task() = default;
+
+    template <class F, class Fn = std::decay_t<F>,
+              class = std::enable_if_t<!std::is_same<Fn, Task>::value>>
+    Task(F&& f) {  // NOLINT: implicit like std::function
+        if constexpr (fitsInline<Fn>()) {
+            ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+            ops_ = &kInlineOps<Fn>;
+        } else {
+            *reinterpret_cast<Fn**>(storage_) = new Fn(std::forward<F>(f));
+            ops_ = &kHeapOps<Fn>;
+        }
+    }
+
+    Task(Task&& other) noexcept { moveFrom(other); }
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { reset(); }
+
+    void operator()() { ops_->invoke(storage_); }
+    explicit operator bool() const { return ops_ != nullptr; }
+    bool isInline() const { return ops_ && ops_->is_inline; }
+
+private:
+    struct Ops {
+        void (*invoke)(void*);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void*);
+        bool is_inline;
+    };
+
+    template <class Fn>
+    static constexpr bool fitsInline() {
+        return sizeof(Fn) <= kInlineSize && alignof(Fn) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    template <class Fn>
+    static constexpr Ops kInlineOps{
+        [](void* p) { (*static_cast<Fn*>(p))(); },
+        [](void* dst, void* src) {
+            ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        },
+        [](void* p) { static_cast<Fn*>(p)->~Fn(); },
+        true,
+    };
+
+    template <class Fn>
+    static constexpr Ops kHeapOps{
+        [](void* p) { (**static_cast<Fn**>(p))(); },
+        [](void* dst, void* src) { *static_cast<Fn**>(dst) = *static_cast<Fn**>(src); },
+        [](void* p) { delete *static_cast<Fn**>(p); },
+        false,
+    };
+
+    void moveFrom(Task& other) noexcept {
+        if (other.ops_) {
+            other.ops_->move(storage_, other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+    void reset() {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+    const Ops* ops_ { nullptr };
+};
+
+// Per-worker deque: the owner pushes and pops at the back (LIFO, cache-warm),
+// thieves take from the front. A ring of Task slots that only grows, so
+// steady-state pushes do not allocate.
+class TaskDeque {
+public:
+    TaskDeque();
+    void push(Task&& t);
+    bool pop(Task& out);
+    bool steal(Task& out);
+    size_t size() const;
+
+private:
+    void lock() const { while (lock_.test_and_set(std::memory_order_acquire)) std::this_thread::yield(); }
+    void unlock() const { lock_.clear(std::memory_order_release); }
+    void grow();
+
+    mutable std::atomic_flag lock_ = ATOMIC_FLAG_INIT;
+    std::vector<Task> ring_;
+    size_t head_ { 0 };
+    size_t count_ { 0 };
+};
+
+// Fixed pool of workers with work stealing. Tasks posted from a worker go to
+// that worker's deque; tasks from other threads are spread round-robin.
+// Workers apply `role` to themselves at start; shared() runs decode work.
+class Executor {
+public:
+    explicit Executor(unsigned threads = 0, sched::Role role = sched::Role::Default);
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    static Executor& shared();
+
+    void post(Task task);
+    // Runs one pending task on the calling thread, if any. Lets a thread that
+    // waits on pool work help instead of blocking a worker.
+    bool runOne();
+    unsigned threadCount() const { return static_cast<unsigned>(workers_.size()); }
+
+private:
+    void workerLoop(size_t index);
+    bool tryTake(size_t self, Task& out);
+
+    const sched::Role role_;
+    std::vector<std::unique_ptr<TaskDeque>> deques_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> pending_ { 0 };
+    std::atomic<size_t> next_ { 0 };
+    std::atomic<bool> stopping_ { false };
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<int> sleepers_ { 0 };
+};
+
+// Runs tasks one at a time in FIFO order on an Executor.
+class SerialQueue {
+public:
+    explicit SerialQueue(const char* label, Executor& executor = Executor::shared());
+    ~SerialQueue();
+
+    SerialQueue(const SerialQueue&) = delete;
+    SerialQueue& operator=(const SerialQueue&) = delete;
+
+    void async(Task task);
+    const char* label() const { return label_; }
+
+private:
+    void drain();
+
+    const char* label_;
+    Executor& executor_;
+    std::mutex mutex_;
+    std::condition_variable idle_cv_;
+    TaskDeque tasks_;
+    bool scheduled_ { false };
+};
+
+// Fork/join helper: run() posts to the executor, wait() helps run pool work
+// until every task in the group has finished.
+class TaskGroup {
+public:
+    explicit TaskGroup(Executor& executor = Executor::shared()) : executor_(executor) {}
+    ~TaskGroup() { wait(); }
+
+    template <class F>
+    void run(F&& f) {
+        outstanding_.fetch_add(1, std::memory_order_relaxed);
+        executor_.post([this, fn = std::forward<F>(f)]() mutable {
+            fn();
+            finishOne();
+        });
+    }
+    void wait();
+
+private:
+    void finishOne();
+
+    Executor& executor_;
+    std::atomic<size_t> outstanding_ { 0 };
+    std::mutex mutex_;
+    std::condition_variable done_cv_;
+};
+
+} // namespace rose
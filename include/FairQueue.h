@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace rose {
+
+// Multi-client request queue for a pool of decode workers. Clients are served
+// round-robin, so one client pipelining many requests cannot starve the others.
+// A worker that takes a short request waits up to `window` for more short ones
+// (from any client, still round-robin) and receives them as one batch.
+template <typename T>
+class FairQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Policy {
+        size_t max_batch = 1;
+        double short_seconds = 0.0;           // requests at most this long may batch
+        std::chrono::milliseconds window { 0 };
+    };
+
+    explicit FairQueue(Policy policy) : policy_(policy) {}
+
+    // False once closed or when `client` already has `limit` requests queued.
+    bool push(uint64_t client, T item, double seconds, size_t limit = SIZE_MAX) {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            if (closed_) return false;
+            auto& q = clients_[client];
+            if (q.size() >= limit) return false;
+            if (q.empty()) ready_.push_back(client);
+            q.push_back(Entry{ std::move(item), seconds, Clock::now() });
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    // Blocks for the next batch; empty once closed.
+    std::vector<T> pop() {
+        std::vector<T> batch;
+        std::unique_lock<std::mutex> lk(mutex_);
+        cv_.wait(lk, [this] { return closed_ || !ready_.empty(); });
+        if (closed_) return batch;
+
+        Entry first = takeLocked(0);
+        batch.push_back(std::move(first.item));
+        if (policy_.max_batch <= 1 || first.seconds > policy_.short_seconds) return batch;
+
+        const auto deadline = first.arrival + policy_.window;
+        while (batch.size() < policy_.max_batch) {
+            const size_t i = nextShortLocked();
+            if (i < ready_.size()) {
+                batch.push_back(std::move(takeLocked(i).item));
+                continue;
+            }
+            if (!cv_.wait_until(lk, deadline, [this] { return closed_ || nextShortLocked() < ready_.size(); })) {
+                break;
+            }
+            if (closed_) break;
+        }
+        return batch;
+    }
+
+    // Drops everything `client` still has queued (it disconnected).
+    void drop(uint64_t client) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        clients_.erase(client);
+        ready_.erase(std::remove(ready_.begin(), ready_.end(), client), ready_.end());
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lk(mutex_);
+        size_t n = 0;
+        for (const auto& kv : clients_) n += kv.second.size();
+        return n;
+    }
+
+private:
+    struct Entry {
+        T item;
+        double seconds;
+        Clock::time_point arrival;
+    };
+
+    // Head of the client at ready_[i]; the client moves to the back of the
+    // rotation if it has more queued, or leaves it.
+    Entry takeLocked(size_t i) {
+        const uint64_t client = ready_[i];
+        ready_.erase(ready_.begin() + static_cast<std::ptrdiff_t>(i));
+        auto it = clients_.find(client);
+        Entry e = std::move(it->second.front());
+        it->second.pop_front();
+        if (it->second.empty()) clients_.erase(it);
+        else ready_.push_back(client);
+        return e;
+    }
+
+    size_t nextShortLocked() const {
+        for (size_t i = 0; i < ready_.size(); ++i) {
+            if (clients_.at(ready_[i]).front().seconds <= policy_.short_seconds) return i;
+        }
+        return ready_.size();
+    }
+
+    const Policy policy_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<uint64_t, std::deque<Entry>> clients_;
+    std::deque<uint64_t> ready_;   // clients with queued requests, in service order
+    bool closed_ { false };
+};
+
+} // namespace rose
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+namespace json {
+
+// `s` as a quoted JSON string literal (UTF-8 passed through, controls escaped).
+std::string quote(const std::string& s);
+
+// Finite numbers as-is; NaN and infinities become null.
+std::string number(double v);
+
+} // namespace json
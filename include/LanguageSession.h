@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include "Constants.h"
+
+namespace rose {
+
+// Auto-language memory across dictations. A run of confident detections of
+// the same language makes it the session language, used without detecting.
+// A weak decode under the session language drops the run to one short of
+// trusted, so the next clip detects again and a single agreeing confident
+// detection restores it.
+class LanguageSession {
+public:
+    // Session language, or empty when the next clip should be detected.
+    std::string cached() const {
+        std::lock_guard<std::mutex> lk(mutex_);
+        return streak_ >= constants::kLanguageSessionHits ? language_ : std::string();
+    }
+
+    void detected(const std::string& language, float probability) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (probability < constants::kLanguageConfidentProb) {
+            streak_ = 0;
+            return;
+        }
+        streak_ = language == language_ ? streak_ + 1 : 1;
+        language_ = language;
+    }
+
+    // Average token log-probability of a clip decoded with cached().
+    void decoded(float avg_logprob) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (avg_logprob < constants::kLanguageRecheckLogprob && streak_ >= constants::kLanguageSessionHits) {
+            streak_ = constants::kLanguageSessionHits - 1;
+        }
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lk(mutex_);
+        language_.clear();
+        streak_ = 0;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::string language_;
+    int streak_ = 0;
+};
+
+} // namespace rose
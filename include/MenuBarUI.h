@@ -9,15 +9,22 @@ public:
 
     bool initialize(std::function<void()> quitCallback,
                    std::function<void()> settingsChangeCallback,
-                   std::function<void()> toggleRecordCallback);
+                   std::function<void()> toggleRecordCallback,
+                   std::function<void()> calibrateCallback,
+                   std::function<void()> retranscribeCallback);
     void setRecordingState(bool recording);
+    // Dictations still queued or in flight in the processing pipeline.
+    void setBacklog(int pending);
     void updateMenu();
     void run();
 
 private:
     void* statusItem;
     void* delegate;
+    bool recording = false;
     std::function<void()> onQuit;
     std::function<void()> onSettingsChange;
     std::function<void()> onToggleRecord;
+    std::function<void()> onCalibrate;
+    std::function<void()> onRetranscribe;
 };
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Process-wide counters and latency histograms, rendered in the Prometheus
+// text exposition format. Metrics are registered by name once (keep the
+// returned reference in a static) and updated with relaxed atomics only, so
+// they are safe on the audio callback and decode threads.
+namespace metrics {
+
+class Counter {
+public:
+    void add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_ { 0 };
+};
+
+// HDR-style histogram: 16 linear sub-buckets per power of two, so any
+// quantile is within ~3% of the true value across the whole uint64 range.
+// Values are recorded as integers in 1/unit (unit 1e6 records seconds as
+// microseconds) and reported back in whole units.
+class Histogram {
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) << kSubBits;
+
+    explicit Histogram(double unit = 1.0) : unit_(unit) {}
+
+    void record(uint64_t raw);
+    void observe(double value);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    double sum() const { return static_cast<double>(sum_.load(std::memory_order_relaxed)) / unit_; }
+    // q in [0, 1]; 0 when empty.
+    double quantile(double q) const;
+
+    static size_t bucketOf(uint64_t raw);
+    static uint64_t bucketLow(size_t index);
+    static uint64_t bucketHigh(size_t index);
+
+private:
+    const double unit_;
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_ {};
+    std::atomic<uint64_t> count_ { 0 };
+    std::atomic<uint64_t> sum_ { 0 };
+};
+
+// Returns the metric registered under `name`, creating it on first use.
+// References stay valid for the life of the process.
+Counter& counter(const char* name, const char* help);
+Histogram& histogram(const char* name, const char* help, double unit = 1e6);
+
+// Every registered metric; histograms as summaries (p50/p90/p99, sum, count).
+std::string render();
+// Writes render() to `path` through a temporary file and rename, so a
+// scraper never reads a partial file.
+bool writeFile(const std::string& path);
+
+// Rewrites `path` every `intervalMs` on its own thread, and once more when
+// destroyed.
+class FileExporter {
+public:
+    FileExporter(std::string path, int intervalMs);
+    ~FileExporter();
+
+    FileExporter(const FileExporter&) = delete;
+    FileExporter& operator=(const FileExporter&) = delete;
+
+private:
+    void run();
+
+    const std::string path_;
+    const int interval_ms_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::thread worker_;
+};
+
+} // namespace metrics
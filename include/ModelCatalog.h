@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace models {
+
+// Weight formats whisper.cpp ships: unquantized (f16) and ggml quantizations.
+enum class Quantization {
+    F16,
+    Q8_0,
+    Q5_1,
+    Q5_0,
+};
+
+struct ModelFile {
+    std::string path;
+    std::string size;          // "tiny", "base", "small", "medium", "large-v3", ...
+    bool english_only = false;
+    Quantization quant = Quantization::F16;
+    std::uintmax_t bytes = 0;
+};
+
+const char* quantization_name(Quantization q);
+bool parse_quantization(const std::string& name, Quantization& out);
+
+// Parses names like "ggml-small.en-q5_1.bin" or "ggml-large-v3.bin".
+bool parse_model_filename(const std::string& filename, ModelFile& out);
+
+// Size family a parsed size belongs to ("large-v3" -> "large").
+std::string size_family(const std::string& size);
+
+// Directories searched for models, in priority order.
+std::vector<std::string> search_directories();
+
+// All parseable ggml models in `dir`, in directory order.
+std::vector<ModelFile> discover(const std::string& dir);
+
+// Whether decoding runs on a GPU backend (Metal on macOS).
+bool gpu_backend();
+
+// Picks a variant of `family` from `found`. `preference` is "auto" or a
+// quantization name; "auto" prefers f16 on GPU and q5 on CPU. Returns nullptr
+// when no variant of the family exists.
+const ModelFile* select(const std::vector<ModelFile>& found,
+                        const std::string& family,
+                        const std::string& preference,
+                        bool gpu);
+
+// select() over each search directory in priority order; the first directory
+// holding any variant of `family` wins. Empty when nothing is found.
+std::string resolve(const std::string& family, const std::string& preference, bool gpu);
+
+} // namespace models
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <iosfwd>
+#include <mutex>
+#include <string>
+
+namespace rose {
+
+// Where dictated text goes. While a clip decodes, partial() receives its text
+// so far each time whisper commits a segment; commit() then delivers the
+// chosen result, replacing what partial() showed if another candidate won.
+// `seq` identifies the dictation. Calls may come from any thread.
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+    virtual void partial(int seq, const std::string& text) = 0;
+    virtual void commit(int seq, const std::string& text) = 0;
+};
+
+// Prints text as it grows: a partial that extends what is on screen prints
+// only the new words, anything else starts a fresh line with the whole
+// revision. commit() ends the line.
+class StdoutSink : public OutputSink {
+public:
+    explicit StdoutSink(std::ostream& out);
+
+    void partial(int seq, const std::string& text) override;
+    void commit(int seq, const std::string& text) override;
+
+private:
+    void show(int seq, const std::string& text);
+
+    std::ostream& out_;
+    std::mutex mutex_;
+    int seq_ = -1;          // dictation on the current line, -1 for none
+    std::string shown_;
+};
+
+// Keeps `path` holding the latest text of the current dictation, replaced
+// through a temporary file and rename so readers never see a partial write.
+// A dictation that ends empty leaves the previous text unless it had shown
+// partials.
+class FileSink : public OutputSink {
+public:
+    explicit FileSink(std::string path);
+
+    void partial(int seq, const std::string& text) override;
+    void commit(int seq, const std::string& text) override;
+
+private:
+    bool write(const std::string& text);
+
+    const std::string path_;
+    std::mutex mutex_;
+    int seq_ = -1;          // dictation the partials in the file belong to
+    std::string written_;
+};
+
+} // namespace rose
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "Executor.h"
+
+namespace rose {
+
+// One stage of a processing pipeline: a bounded FIFO of tasks drained by a
+// dedicated thread. Chaining stages (a task pushes its follow-up into the next
+// stage) keeps clips in order while different clips occupy different stages.
+// A full stage blocks the pushing stage, so backpressure propagates upstream;
+// depth() and blockedMs() make it visible. The stage thread runs with `role`.
+class PipelineStage {
+public:
+    PipelineStage(const char* name, size_t capacity, sched::Role role = sched::Role::Pipeline);
+    ~PipelineStage();
+
+    PipelineStage(const PipelineStage&) = delete;
+    PipelineStage& operator=(const PipelineStage&) = delete;
+
+    // Blocks while the stage is full.
+    void push(Task task);
+    // Moves from `task` only on success.
+    bool tryPush(Task& task);
+
+    const char* name() const { return name_; }
+    size_t capacity() const { return capacity_; }
+    // Tasks queued plus the one running, if any.
+    size_t depth() const;
+    bool full() const { return depth() >= capacity_; }
+    size_t highWater() const { return high_water_.load(std::memory_order_relaxed); }
+    // Total time producers spent blocked on this stage.
+    double blockedMs() const { return blocked_us_.load(std::memory_order_relaxed) / 1000.0; }
+
+private:
+    void run();
+    void enqueueLocked(Task&& task);
+
+    const char* name_;
+    const size_t capacity_;
+    const sched::Role role_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    TaskDeque tasks_;
+    size_t queued_ { 0 };
+    bool busy_ { false };
+    bool stopping_ { false };
+    std::atomic<size_t> high_water_ { 0 };
+    std::atomic<uint64_t> blocked_us_ { 0 };
+    std::thread worker_;
+};
+
+} // namespace rose
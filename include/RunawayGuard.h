@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "Constants.h"
+#include "TextScoring.h"
+
+namespace rose {
+
+// Decides when one candidate decode is looping instead of transcribing: more
+// tokens than its clip could hold, or committed text ending in a repeated
+// n-gram. Tokens are counted as those of committed segments plus the longest
+// sequence of the window attempt under way, so a temperature fallback that
+// re-decodes a window starts its count over instead of adding to it.
+class RunawayGuard {
+public:
+    explicit RunawayGuard(int64_t token_cap) : token_cap_(token_cap) {}
+
+    // Length of a decoder's token sequence in the current window attempt.
+    void sampling(int attempt_tokens) {
+        if (attempt_tokens > attempt_) attempt_ = attempt_tokens;
+        if (committed_tokens_ + attempt_ > token_cap_) over_cap_ = true;
+    }
+
+    // A segment whisper committed; the next window starts a new attempt.
+    void committed(const std::string& text, int tokens) {
+        committed_tokens_ += tokens;
+        attempt_ = 0;
+        text_ += text;
+        if (committed_tokens_ > token_cap_) over_cap_ = true;
+        looping_ = textscore::repetition_start(text_, constants::kRepeatMaxNgram, constants::kRepeatMinRepeats,
+                                               constants::kRepeatMinWords) != std::string::npos;
+    }
+
+    bool overCap() const { return over_cap_; }
+    bool looping() const { return looping_; }
+    bool fired() const { return over_cap_ || looping_; }
+    int64_t tokens() const { return committed_tokens_ + attempt_; }
+
+private:
+    const int64_t token_cap_;
+    int64_t committed_tokens_ = 0;
+    int64_t attempt_ = 0;
+    std::string text_;
+    bool over_cap_ = false;
+    bool looping_ = false;
+};
+
+} // namespace rose
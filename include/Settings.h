@@ -1,7 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <functional>
+#include <thread>
+#include <vector>
+#include "Calibration.h"
 
 class Settings {
 public:
@@ -13,50 +21,125 @@ public:
         MODEL_LARGE = 4
     };
 
+    // One consistent set of settings. Published snapshots are immutable; a
+    // setter copies the current one, changes the copy and publishes it.
+    struct Values {
+        Model model;
+        int bestOfN;
+        std::string hotkey;
+        int deviceId;
+        std::string language;
+        int retainSeconds;
+        std::string quantization[MODEL_LARGE + 1];
+        int latencyTargetMs;
+        int endpointSilenceMs;
+        std::vector<calibration::ModelProfile> calibrationProfiles;
+
+        Values();
+        Model effectiveModel() const;
+        int decodeThreads() const;
+
+    private:
+        bool calibratedChoice(calibration::Choice& out) const;
+    };
+
     static Settings& getInstance();
 
+    // File load() and save() use; ~/.rose_config unless set. Changing it
+    // neither reloads nor saves, so tests can point the instance elsewhere.
+    std::string getConfigPath() const;
+    void setConfigPath(const std::string& path);
+
     void load();
+    // Writes the current settings now. Setters only schedule a write, which a
+    // background thread makes once changes have settled.
     void save();
 
-    Model getModel() const { return model; }
+    // Current settings without taking a lock: one atomic shared_ptr load.
+    // Hold on to the pointer to read several values from the same snapshot;
+    // it is freed once the last holder lets go.
+    std::shared_ptr<const Values> snapshot() const {
+        return std::atomic_load_explicit(&current, std::memory_order_acquire);
+    }
+
+    Model getModel() const { return snapshot()->model; }
     void setModel(Model m);
 
-    int getBestOfN() const { return bestOfN; }
+    int getBestOfN() const { return snapshot()->bestOfN; }
     void setBestOfN(int n);
 
-    std::string getHotkey() const { return hotkey; }
+    std::string getHotkey() const { return snapshot()->hotkey; }
     void setHotkey(const std::string& key);
 
-    int getDeviceId() const { return deviceId; }
+    int getDeviceId() const { return snapshot()->deviceId; }
     void setDeviceId(int id);
 
     std::string getModelPath() const;
     std::string getModelName() const;
+    static const char* modelFamily(Model m);
 
-    std::string getLanguage() const { return language; }
+    // Quantization preference ("auto", "f16", "q8_0", ...) for the current model size.
+    std::string getQuantization() const {
+        const auto v = snapshot();
+        return v->quantization[v->effectiveModel()];
+    }
+    std::string getQuantizationFor(Model m) const { return snapshot()->quantization[m]; }
+    void setQuantization(const std::string& quant);
+
+    std::string getLanguage() const { return snapshot()->language; }
     void setLanguage(const std::string& lang);
 
-    int getModelRetainSeconds() const { return retainSeconds; }
+    // Latency target in ms; when set and calibration data exists, the model and
+    // decoder thread count are chosen automatically instead of from getModel().
+    int getLatencyTargetMs() const { return snapshot()->latencyTargetMs; }
+    void setLatencyTargetMs(int ms);
+
+    std::vector<calibration::ModelProfile> getCalibration() const { return snapshot()->calibrationProfiles; }
+    void setCalibration(std::vector<calibration::ModelProfile> profiles);
+
+    // Model and per-decoder thread count actually used for transcription.
+    Model getEffectiveModel() const { return snapshot()->effectiveModel(); }
+    int getDecodeThreads() const { return snapshot()->decodeThreads(); }
+
+    int getModelRetainSeconds() const { return snapshot()->retainSeconds; }
     void setModelRetainSeconds(int seconds);
 
+    // Trailing silence that ends a recording on its own; kEndpointOff leaves
+    // stopping to the hotkey.
+    int getEndpointSilenceMs() const { return snapshot()->endpointSilenceMs; }
+    void setEndpointSilenceMs(int ms);
+
     void setOnChangeCallback(std::function<void()> callback) {
         onChangeCallback = callback;
     }
 
 private:
     Settings();
+    ~Settings();
     Settings(const Settings&) = delete;
     Settings& operator=(const Settings&) = delete;
 
-    Model model;
-    int bestOfN;
-    std::string hotkey;
-    int deviceId;
     std::string configPath;
     std::function<void()> onChangeCallback;
 
     void notifyChange();
 
-    std::string language;
-    int retainSeconds;
+    // Applies `change` to a copy of the current snapshot and, if it returns
+    // true, publishes the copy, schedules a save and notifies.
+    void update(const std::function<bool(Values&)>& change);
+    void publish(std::unique_ptr<Values> next);
+    bool write(const Values& v) const;
+    void scheduleSave();
+    void saveLoop();
+
+    std::shared_ptr<const Values> current;   // only through std::atomic_load/store
+    std::mutex writeMutex;   // serializes setters and load()
+    mutable std::mutex fileMutex;   // serializes write() and guards configPath
+
+    std::mutex saveMutex;
+    std::condition_variable saveCv;
+    bool saveDirty = false;
+    bool saveStopping = false;
+    std::chrono::steady_clock::time_point saveDue;
+    std::thread saveThread;  // started by the first scheduled save
 };
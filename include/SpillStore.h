@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace audio {
+
+// Append-only int16 PCM in an unlinked temporary file, for recordings longer
+// than the capture ring. The recorder appends sealed chunks with plain writes
+// while recording; seal() then maps the file read-only and decoding reads
+// chunks straight from the mapping. Pages live in the page cache, not the
+// process, and release() drops the ones already read, so resident memory
+// stays flat however long the recording. One writer, then readers.
+class SpillStore {
+public:
+    // At most `max_samples`; the file is created in `dir` and unlinked at once,
+    // so it disappears with the store (or the process).
+    SpillStore(std::string dir, size_t max_samples);
+    ~SpillStore();
+
+    SpillStore(const SpillStore&) = delete;
+    SpillStore& operator=(const SpillStore&) = delete;
+
+    bool open(std::string* error = nullptr);
+
+    // False past max_samples or on a write error; nothing is appended then.
+    bool append(const int16_t* samples, size_t n);
+    // Drops everything from sample `n` on.
+    void truncate(size_t n);
+    size_t size() const { return size_; }
+    bool full() const { return size_ >= max_samples_; }
+
+    // Maps what was written. Appending ends here.
+    bool seal();
+    // Samples [offset, size()) in the mapping; valid until destruction.
+    const int16_t* data(size_t offset = 0) const { return map_ + offset; }
+    // Tells the kernel [offset, offset + n) will not be read again.
+    void release(size_t offset, size_t n) const;
+
+private:
+    const std::string dir_;
+    const size_t max_samples_;
+    int fd_ = -1;
+    size_t size_ = 0;
+    const int16_t* map_ = nullptr;
+    size_t map_bytes_ = 0;
+};
+
+// End of the decode chunk starting at `begin`: `begin + max_len`, moved back
+// to the quietest 20 ms frame in the last `search` samples so a cut falls
+// between words. The rest of the store when that is shorter.
+size_t chunk_end(const SpillStore& store, size_t begin, size_t max_len, size_t search, int sample_rate);
+
+} // namespace audio
@@ -1,13 +1,24 @@
 ﻿#pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+// One whisper segment; times are milliseconds from the start of the decoded audio.
+struct TranscriptSegment {
+    std::string text;
+    int64_t t0_ms;
+    int64_t t1_ms;
+};
+
 struct TranscriptionResult {
     std::string text;
     float avg_logprob;
     float no_speech_prob;
     float score;
+    std::vector<TranscriptSegment> segments {};
+    bool truncated = false;     // decoding was cut off at its deadline; text may be partial
+    bool degenerate = false;    // aborted while looping; text stops before the loop
 };
 
 namespace textscore {
@@ -18,7 +29,21 @@ inline float score(const TranscriptionResult& r) {
     return score(r.avg_logprob, r.no_speech_prob);
 }
 
+// Highest score, preferring any decode that did not loop, then any finished
+// decode over a truncated one.
 const TranscriptionResult& select_best(const std::vector<TranscriptionResult>& results);
 
+// Byte offset in `text` where a repetition loop starts: the tail is one
+// n-gram of at most `max_n` words, repeated at least `min_repeats` times and
+// covering `min_words` words; the offset is that of its second repeat, so
+// text before it keeps one copy. npos when the text does not end in a loop.
+// Words compare as in word_error_rate.
+size_t repetition_start(const std::string& text, int max_n, int min_repeats, int min_words);
+
+// Word error rate of `hypothesis` against `reference` after lowercasing and
+// dropping punctuation: word edits / reference words (1 when only the
+// reference is empty, 0 when both are).
+double word_error_rate(const std::string& reference, const std::string& hypothesis);
+
 } // namespace textscore
 
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Scheduling policy by thread role, applied by each thread to itself at
+// start. Best effort throughout: a refused request leaves default scheduling.
+//
+// Linux: the audio thread asks for SCHED_FIFO (else a negative nice value)
+// and is pinned to one reserved CPU; decode threads are confined to the
+// decode CPU set, which never includes that CPU. macOS has no affinity API
+// on Apple Silicon, so roles map to QoS classes instead, which steer decode
+// work to the performance cores; CoreAudio already runs the audio callback
+// on a real-time thread. Threads a decode thread creates (whisper's compute
+// threads) inherit its affinity and QoS.
+namespace sched {
+
+enum class Role {
+    Default,    // leave as is
+    Audio,      // capture callback
+    Decode,     // candidate decoding and its pool workers
+    Pipeline,   // preprocess/output stages and other latency-relevant work
+};
+
+// True if everything the role asks for was granted.
+bool apply(Role role);
+
+// Sets a CPU aside for the audio thread. Call before any thread applies a
+// role; processes that never capture (rose-cli, rose-daemon) keep every CPU
+// for decoding.
+void reserveAudioCpu();
+
+// CPUs for decode threads: kDecodeCpusEnvVar if set, else the performance
+// cores, less the audio CPU. Empty means unrestricted (and always on macOS).
+const std::vector<int>& decodeCpus();
+// CPU the audio thread is pinned to, or -1 for none.
+int audioCpu();
+
+// "0-3,6" -> {0, 1, 2, 3, 6}; sorted, without duplicates. Empty on a
+// malformed list.
+std::vector<int> parseCpuList(const std::string& list);
+// CPUs whose maximum frequency is the highest among `max_khz` (indexed by
+// CPU); all of them when any frequency is unknown (0) or all are equal.
+std::vector<int> fastestCpus(const std::vector<long>& max_khz);
+
+} // namespace sched
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Low-overhead tracing. Scoped spans record complete events into a ring
+// buffer owned by the calling thread; dump() writes every ring as Chrome
+// trace-event JSON (chrome://tracing, ui.perfetto.dev).
+//
+// Disabled, a span is one relaxed atomic load. Enabled, recording is a few
+// stores into the thread's ring and never locks, except the first event on a
+// thread, which allocates its ring. Names must be string literals.
+namespace trace {
+
+namespace detail {
+extern std::atomic<bool> g_enabled;
+uint64_t now_ns();
+void record(const char* name, uint64_t start_ns, uint64_t end_ns, int64_t arg);
+} // namespace detail
+
+inline constexpr int64_t kNoArg = INT64_MIN;
+
+inline bool enabled() { return detail::g_enabled.load(std::memory_order_relaxed); }
+void setEnabled(bool on);
+
+// Label for the calling thread in the trace viewer. Cheap; call it once
+// at thread start whether or not tracing is on.
+void setThreadName(const char* name);
+
+// Zero-length marker.
+inline void instant(const char* name, int64_t arg = kNoArg) {
+    if (enabled()) {
+        const uint64_t t = detail::now_ns();
+        detail::record(name, t, t, arg);
+    }
+}
+
+class Span {
+public:
+    explicit Span(const char* name, int64_t arg = kNoArg)
+        : name_(name), arg_(arg), start_(enabled() ? detail::now_ns() : 0) {}
+    ~Span() {
+        if (start_ != 0) detail::record(name_, start_, detail::now_ns(), arg_);
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* name_;
+    int64_t arg_;
+    uint64_t start_;
+};
+
+// Every thread's buffered events; events still being written to a wrapped
+// ring may be missing. False if the file cannot be written.
+bool dump(const std::string& path);
+
+} // namespace trace
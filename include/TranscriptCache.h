@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TextScoring.h"
+
+// On-disk transcription cache, keyed by a fingerprint of the preprocessed PCM
+// plus everything that changes the result (model, language, candidates).
+//
+// The file is an append-only log of records behind a small header, read
+// through a memory map. New records are appended under an flock(), so several
+// processes can share one cache; each picks up the others' appends when a
+// lookup misses. Past the size cap the log is compacted into a new file
+// (atomic rename) keeping the most recently used entries.
+class TranscriptCache {
+public:
+    struct Key {
+        uint64_t hi = 0;
+        uint64_t lo = 0;
+        bool operator==(const Key& o) const { return hi == o.hi && lo == o.lo; }
+    };
+
+    static Key makeKey(const std::vector<float>& pcm,
+                       const std::string& model,
+                       const std::string& language,
+                       int bestOfN);
+
+    TranscriptCache(std::string path, size_t maxBytes);
+    ~TranscriptCache();
+
+    TranscriptCache(const TranscriptCache&) = delete;
+    TranscriptCache& operator=(const TranscriptCache&) = delete;
+
+    // Creates the file if needed and indexes it; a torn tail record from a
+    // crashed writer is cut off.
+    bool open(std::string* error = nullptr);
+
+    // Cached results carry no segments.
+    bool lookup(const Key& key, TranscriptionResult& out);
+    void store(const Key& key, const TranscriptionResult& result);
+
+    const std::string& path() const { return path_; }
+    size_t entries() const;
+    size_t bytes() const;
+    size_t hits() const;
+    size_t misses() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& k) const { return static_cast<size_t>(k.hi ^ (k.lo * 0x9e3779b97f4a7c15ull)); }
+    };
+    struct Entry {
+        size_t offset;      // record start in the file
+        uint64_t used;      // use clock tick of the last store or hit
+    };
+
+    bool reopenLocked(std::string* error);
+    bool remapLocked(size_t size);
+    void unmapLocked();
+    // Index records in [from, file end); returns the end of the last valid one.
+    size_t indexLocked(size_t from);
+    bool refreshLocked();
+    void compactLocked();
+
+    const std::string path_;
+    const size_t maxBytes_;
+    mutable std::mutex mutex_;
+    int fd_ { -1 };
+    uint64_t inode_ { 0 };
+    const unsigned char* map_ { nullptr };
+    size_t mapSize_ { 0 };
+    size_t indexedEnd_ { 0 };
+    uint64_t clock_ { 0 };
+    size_t hits_ { 0 };
+    size_t misses_ { 0 };
+    std::unordered_map<Key, Entry, KeyHash> index_;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DaemonProtocol.h"
+#include "Executor.h"
+#include "FairQueue.h"
+#include "WhisperProcessor.h"
+
+struct ServerOptions {
+    std::string socket_path;
+    int slots = 2;                  // batches decoding at once
+    int slot_threads = constants::kWhisperThreads;  // whisper threads per slot, split across a batch
+    size_t max_batch = constants::kDaemonMaxBatch;
+    double short_seconds = constants::kDaemonShortClipSeconds;
+    int batch_window_ms = constants::kDaemonBatchWindowMs;
+    bool pack = true;               // batched clips share encoder windows
+    DecodeOptions defaults;         // language and best-of when a request leaves them unset
+};
+
+// Serves transcription requests from local clients over a Unix socket with one
+// resident model. Each connection has a reader thread that decodes frames into
+// PCM and queues them; `slots` workers take fair, micro-batched work from the
+// queue and decode it on the processor's pooled whisper states, packing each
+// batch into as few encoder windows as it fits. Each slot runs its candidates
+// on its own executor of `defaults.bestOfN` workers, so `slots` bounds how
+// many decoders share the cores.
+class TranscriptionServer {
+public:
+    TranscriptionServer(WhisperProcessor& processor, ServerOptions options);
+    ~TranscriptionServer();
+
+    bool start(std::string* error = nullptr);
+    // Stops accepting, closes connections and joins every thread. Requests
+    // still queued are dropped.
+    void stop();
+
+private:
+    struct Connection {
+        uint64_t id = 0;
+        int fd = -1;
+        std::mutex write_mutex;
+        std::atomic<bool> open { true };
+        ~Connection();
+    };
+
+    struct Job {
+        std::shared_ptr<Connection> conn;
+        uint32_t request_id = 0;
+        std::vector<float> pcm;
+        DecodeOptions options;
+        std::chrono::steady_clock::time_point received;
+    };
+
+    void acceptLoop();
+    void readLoop(std::shared_ptr<Connection> conn);
+    void workerLoop();
+    void runBatch(std::vector<Job>& batch, rose::Executor& decoders);
+    void reply(Connection& conn, uint32_t id, ipc::Status status, const std::string& body);
+
+    WhisperProcessor& processor_;
+    const ServerOptions options_;
+    rose::FairQueue<Job> queue_;
+    int listen_fd_ { -1 };
+    std::atomic<bool> stopping_ { false };
+    std::atomic<uint64_t> next_client_ { 1 };
+    std::thread acceptor_;
+    std::vector<std::thread> workers_;
+    std::mutex conns_mutex_;
+    std::condition_variable readers_done_;
+    std::map<uint64_t, std::shared_ptr<Connection>> conns_;   // one detached reader each
+};
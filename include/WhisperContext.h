@@ -1,7 +1,10 @@
 ﻿#pragma once
 
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 struct whisper_context;
 struct whisper_state;
@@ -33,7 +36,44 @@ public:
 
     State createState() const;
 
+    // Pooled states keep their compute buffers between transcriptions. A state
+    // released after the model was reloaded is dropped instead of pooled.
+    class StateLease {
+    public:
+        StateLease(WhisperContext& owner, State state, uint64_t generation)
+            : owner_(&owner), state_(std::move(state)), generation_(generation) {}
+        ~StateLease() { if (owner_ && state_) owner_->releaseState(std::move(state_), generation_); }
+        StateLease(StateLease&& other) noexcept
+            : owner_(other.owner_), state_(std::move(other.state_)), generation_(other.generation_) {
+            other.owner_ = nullptr;
+        }
+        StateLease(const StateLease&) = delete;
+        StateLease& operator=(const StateLease&) = delete;
+        StateLease& operator=(StateLease&&) = delete;
+
+        whisper_state* get() const { return state_.get(); }
+        explicit operator bool() const { return static_cast<bool>(state_); }
+
+    private:
+        WhisperContext* owner_;
+        State state_;
+        uint64_t generation_;
+    };
+
+    StateLease acquireState();
+    // Creates states until the pool holds at least `count`.
+    void reserveStates(size_t count);
+    size_t pooledStates() const;
+
 private:
+    void releaseState(State state, uint64_t generation);
+    void clearPool();
+
     static void context_deleter(whisper_context*);
     std::unique_ptr<whisper_context, void(*)(whisper_context*)> ctx_{nullptr, &WhisperContext::context_deleter};
+
+    // Declared after ctx_ so pooled states are freed before the context.
+    mutable std::mutex pool_mutex_;
+    std::vector<State> pool_;
+    uint64_t generation_ { 0 };
 };
@@ -1,27 +1,186 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
+#include "Constants.h"
+#include "LanguageSession.h"
+#include "SpillStore.h"
 #include "TextScoring.h"
+#include "TranscriptCache.h"
 #include "WhisperContext.h"
 
+namespace rose { class Executor; }
+
+struct LatencyStats {
+    double load_ms = 0.0;
+    double warmup_ms = 0.0;
+    double first_ms = 0.0;
+    double steady_total_ms = 0.0;
+    int transcriptions = 0;
+
+    double steadyAverageMs() const {
+        return transcriptions > 1 ? steady_total_ms / (transcriptions - 1) : 0.0;
+    }
+};
+
+// Wall time of each step of one transcription. Candidates decode in parallel,
+// so the state, encode and decode figures are the slowest candidate's.
+struct StageTimings {
+    double preprocess_ms = 0.0;
+    double state_ms = 0.0;      // pooled state acquire (allocates on a cold pool)
+    double encode_ms = 0.0;     // log-mel and encoder, up to the first decoder step
+    double decode_ms = 0.0;     // token decoding
+    double scoring_ms = 0.0;    // candidate selection
+    double total_ms = 0.0;
+};
+
+// Per-request decode settings. The app builds them from Settings; batch tools
+// pass their own so nothing is read from or written to ~/.rose_config.
+struct DecodeOptions {
+    std::string language = "en";    // "auto" detects the language per clip
+    // With "auto", reuse the language of recent confident detections (see
+    // LanguageSession) instead of detecting each clip. Only right when every
+    // clip is the same speaker: the app sets it; servers and batch tools,
+    // whose clips come from many sources, detect every clip.
+    bool useLanguageSession = false;
+    int bestOfN = constants::kBestOfNDefault;
+    int threads = constants::kWhisperThreads;  // whisper threads per candidate decoder
+    bool gpu = constants::kUseGPU;
+    bool wordSegments = false;      // one segment per word, for splitting packed windows
+    // Latency budget from the start of decode(); 0 for none. Past it, running
+    // candidates abort and the result comes back with `truncated` set.
+    int deadlineMs = 0;
+    // Check for silence with one cheap pass before spawning candidates (see
+    // kNoSpeechProbeMinCandidates for when it runs).
+    bool noSpeechProbe = true;
+    // Cut long interior pauses before decoding; segment times stay on the
+    // original timeline.
+    bool compactPauses = true;
+    // Text so far of the T=0 candidate, called on its decode thread each time
+    // whisper commits a segment. Provisional: the returned result may come
+    // from another candidate.
+    std::function<void(const std::string&)> onPartial;
+    // Keep this clip for retranscribeLast(): its prepared audio and, when the
+    // no-speech/language probe encoded it, that pooled state until the next
+    // decode. Off for batch tools, which would only pay for the copy.
+    bool keepForRetranscribe = false;
+    // Pool the candidates (and packed windows) fan out on; null for
+    // Executor::shared(). A server gives each slot its own so a batch never
+    // runs more candidates at once than the slot's share of the cores.
+    rose::Executor* executor = nullptr;
+
+    static DecodeOptions fromSettings();
+};
+
 class WhisperProcessor {
 public:
     WhisperProcessor();
     ~WhisperProcessor();
 
     bool initialize(const std::string& modelPath);
+    bool initialize(const std::string& modelPath, bool useGpu);
     std::string transcribe(const std::vector<float>& audioData);
+    // transcribe() with explicit options, reporting where the time went.
+    TranscriptionResult transcribe(const std::vector<float>& audioData, const DecodeOptions& options,
+                                   StageTimings* timings = nullptr);
+    // The two halves of transcribe(), so a pipeline can preprocess one clip
+    // while another decodes. prepare() needs no model and returns an empty
+    // buffer for clips too short to decode.
+    std::vector<float> prepare(const std::vector<float>& audioData);
+    std::string decode(const std::vector<float>& prepared);
+    // Best candidate with its scores. Safe to call from several threads at
+    // once; each candidate decodes on its own pooled whisper state.
+    TranscriptionResult decode(const std::vector<float>& prepared, const DecodeOptions& options,
+                               StageTimings* timings = nullptr);
+    // Prepared clips packed into as few windows as possible (see ClipPacking.h)
+    // and split back per clip. Every clip from a window shares its scores.
+    std::vector<TranscriptionResult> decodePacked(const std::vector<std::vector<float>>& prepared,
+                                                  const DecodeOptions& options);
+    // A recording spilled to disk (see AudioRecorder::takeSpilledCapture),
+    // decoded in windows of kSpillDecodeSeconds cut at pauses. Each window is
+    // converted straight from the mapping into one reused buffer, so memory
+    // stays at one window however long the recording. The language is settled
+    // once and no window is skipped as silent. Segment times are on the
+    // recording's timeline; onPartial sees the text so far. No deadline.
+    TranscriptionResult decodeChunked(const audio::SpillStore& store, const DecodeOptions& options);
+    // The last clip kept by decode() (see DecodeOptions::keepForRetranscribe),
+    // decoded again with new options, typically another language or bestOfN.
+    // With the same model and a clip of one window, only the decoder runs: on
+    // the probe's retained encoder output, or one encoded here and kept for
+    // the next correction. Candidates decode text without timestamps, one
+    // after another on that state. Otherwise the kept audio goes through
+    // decode() again, still skipping capture and preprocessing.
+    TranscriptionResult retranscribeLast(const DecodeOptions& options);
+    bool hasLastClip() const;
+    // Runs a short synthetic decode so backend init, first-touch page faults and
+    // graph allocation are paid before the first real transcription.
+    // Threads and candidate count come from the caller's decode options.
+    bool warmUp(const DecodeOptions& options);
     void unload();
 
+    LatencyStats latencyStats() const;
+    // Per-dictation log lines on stdout; batch tools turn them off.
+    void setLogging(bool enabled) { logging = enabled; }
+    // decode() returns cached results for audio it has seen with the same
+    // model and options, and stores new ones; decodePacked() bypasses the
+    // cache. Not owned.
+    void setCache(TranscriptCache* c) { cache = c; }
+    // Clips the no-speech probe answered without running candidates.
+    uint64_t probeSkips() const { return probe_skips.load(std::memory_order_relaxed); }
+
 private:
+    int candidateCount(const DecodeOptions& options) const;
+    void recordLatency(double total_ms);
+    struct ClipProbe {
+        std::string language;           // for the candidates; "auto" if detection failed
+        bool from_session = false;
+        float no_speech_prob = -1.0f;   // < 0 when not measured
+        float first_logprob = 0.0f;     // of the first text token; -inf when none
+    };
+    // Resolves an "auto" language (session, else one detection) and, with
+    // noSpeech, measures the no-speech probability, sharing one encoder pass.
+    // `keep`, when given, receives the state once it holds the clip's encoding.
+    ClipProbe probeClip(const std::vector<float>& audio, const DecodeOptions& options, bool noSpeech,
+                        std::unique_ptr<WhisperContext::StateLease>* keep = nullptr);
+    // One candidate decoded on a state that already holds the clip's encoder
+    // output: greedy at temperature 0, sampled above it. Deliberately simpler
+    // than whisper_full: no timestamps, no suppress_nst, end-of-text barred at
+    // the first step, and no token cap besides the repetition check and the
+    // text context. The caller applies the no-speech check to the winner.
+    TranscriptionResult decodeEncoded(whisper_state* state, int lang_id, float temperature, int threads,
+                                      uint32_t seed);
     std::vector<float> preprocessAudio(const std::vector<float>& audioData);
     std::vector<float> removeNoise(const std::vector<float>& audioData);
     std::vector<float> normalizeAudio(const std::vector<float>& audioData);
     std::vector<float> applyHighPassFilter(const std::vector<float>& audioData);
     bool detectVoiceActivity(const std::vector<float>& audioData);
-    TranscriptionResult runTranscription(const std::vector<float>& audioData, float temperature);
+    TranscriptionResult runTranscription(const std::vector<float>& audioData, float temperature,
+                                         const DecodeOptions& options,
+                                         std::chrono::steady_clock::time_point deadline,
+                                         StageTimings* timings = nullptr);
     TranscriptionResult selectBestResult(const std::vector<TranscriptionResult>& results);
 
     WhisperContext context;
+    std::string modelId;            // file name and size: part of every cache key
+    TranscriptCache* cache = nullptr;
+    rose::LanguageSession languageSession;
+    std::atomic<uint64_t> probe_skips { 0 };
+    struct LastClip {
+        std::vector<float> prepared;
+        std::string language;   // detected for it, reused by an "auto" retranscribe
+        std::unique_ptr<WhisperContext::StateLease> encoded;   // mel and encoder output of its window
+        uint64_t serial = 0;    // bumped per kept clip and per model change
+    };
+    mutable std::mutex lastMutex;
+    LastClip last;
+    void dropEncoded();
+    mutable std::mutex statsMutex;
+    LatencyStats stats;
+    bool logging = true;
 };
@@ -0,0 +1,124 @@
+#include "AudioFile.h"
+
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace audio {
+
+namespace {
+
+uint16_t read_u16(const unsigned char* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t read_u32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+bool fail(std::string* error, const std::string& msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+} // namespace
+
+std::vector<float> resample_linear(const std::vector<float>& audio,
+                                   int from_rate,
+                                   int to_rate) {
+    if (audio.empty() || from_rate <= 0 || to_rate <= 0 || from_rate == to_rate) return audio;
+    const double ratio = static_cast<double>(from_rate) / to_rate;
+    const size_t n_out = static_cast<size_t>(audio.size() / ratio);
+    std::vector<float> out(n_out);
+    for (size_t i = 0; i < n_out; ++i) {
+        const double pos = i * ratio;
+        const size_t i0 = static_cast<size_t>(pos);
+        const size_t i1 = std::min(i0 + 1, audio.size() - 1);
+        const float frac = static_cast<float>(pos - i0);
+        out[i] = audio[i0] + (audio[i1] - audio[i0]) * frac;
+    }
+    return out;
+}
+
+bool load_wav(const std::string& path,
+              int sample_rate,
+              std::vector<float>& out,
+              std::string* error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return fail(error, "cannot open " + path);
+    const std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)),
+                                           std::istreambuf_iterator<char>());
+    return decode_wav(bytes.data(), bytes.size(), sample_rate, out, error);
+}
+
+bool decode_wav(const unsigned char* bytes,
+                size_t size,
+                int sample_rate,
+                std::vector<float>& out,
+                std::string* error) {
+    if (size < 12 || std::memcmp(bytes, "RIFF", 4) != 0 || std::memcmp(bytes + 8, "WAVE", 4) != 0) {
+        return fail(error, "not a RIFF/WAVE file");
+    }
+
+    uint16_t format = 0, channels = 0, bits = 0;
+    uint32_t rate = 0;
+    const unsigned char* data = nullptr;
+    size_t data_size = 0;
+
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const unsigned char* chunk = bytes + pos;
+        const uint32_t chunk_size = read_u32(chunk + 4);
+        const size_t body = pos + 8;
+        const size_t avail = std::min<size_t>(chunk_size, size - body);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && avail >= 16) {
+            format = read_u16(chunk + 8);
+            channels = read_u16(chunk + 10);
+            rate = read_u32(chunk + 12);
+            bits = read_u16(chunk + 22);
+            // WAVE_FORMAT_EXTENSIBLE carries the real format in the sub-format GUID.
+            if (format == 0xFFFE && avail >= 26) format = read_u16(chunk + 32);
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            data = bytes + body;
+            data_size = avail;
+        }
+        pos = body + chunk_size + (chunk_size & 1);
+    }
+
+    if (!data || channels == 0 || rate == 0) return fail(error, "missing fmt or data chunk");
+    const bool is_float = format == 3 && bits == 32;
+    if (!is_float && (format != 1 || (bits != 8 && bits != 16 && bits != 24 && bits != 32))) {
+        return fail(error, "unsupported WAV encoding");
+    }
+
+    const size_t bytes_per_sample = bits / 8;
+    const size_t frames = data_size / (bytes_per_sample * channels);
+    std::vector<float> mono(frames, 0.0f);
+    for (size_t f = 0; f < frames; ++f) {
+        float acc = 0.0f;
+        for (size_t c = 0; c < channels; ++c) {
+            const unsigned char* p = data + (f * channels + c) * bytes_per_sample;
+            float v = 0.0f;
+            if (is_float) {
+                uint32_t u = read_u32(p);
+                std::memcpy(&v, &u, sizeof v);
+            } else if (bits == 8) {
+                v = (static_cast<int>(p[0]) - 128) / 128.0f;
+            } else if (bits == 16) {
+                v = static_cast<int16_t>(read_u16(p)) / 32768.0f;
+            } else if (bits == 24) {
+                int32_t s = static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<uint32_t>(p[2]) << 24)) >> 8;
+                v = s / 8388608.0f;
+            } else {
+                v = static_cast<int32_t>(read_u32(p)) / 2147483648.0f;
+            }
+            acc += v;
+        }
+        mono[f] = acc / channels;
+    }
+
+    out = resample_linear(mono, static_cast<int>(rate), sample_rate);
+    return true;
+}
+
+} // namespace audio
@@ -1,16 +1,69 @@
 #include "AudioRecorder.h"
 #include "Settings.h"
 #include "Constants.h"
+#include "AudioUtils.h"
+#include "Endpointer.h"
+#include "Metrics.h"
+#include "ThreadPolicy.h"
+#include "Trace.h"
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 #include <cmath>
 #include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iterator>
 
-namespace { std::atomic<bool> g_pa_initialized{false}; }
+namespace {
+std::atomic<bool> g_pa_initialized{false};
+
+// Registered before any stream starts, so the callback never takes the registry lock.
+metrics::Counter& g_input_overflows = metrics::counter(
+    "rose_audio_input_overflows_total", "Audio callbacks reporting an input overflow (samples lost upstream).");
+metrics::Counter& g_dropped_samples = metrics::counter(
+    "rose_audio_dropped_samples_total", "Captured samples overwritten by recordings longer than the ring.");
+metrics::Counter& g_audio_priority_denied = metrics::counter(
+    "rose_audio_priority_denied_total", "Audio threads refused elevated priority or their CPU.");
+metrics::Counter& g_endpoint_stops = metrics::counter(
+    "rose_endpoint_stops_total", "Recordings ended by trailing silence rather than the hotkey.");
+
+std::string tempDir() {
+    const char* dir = std::getenv("TMPDIR");
+    std::string out = dir && dir[0] ? dir : "/tmp";
+    while (out.size() > 1 && out.back() == '/') out.pop_back();
+    return out;
+}
+
+template <typename T>
+void writeRing(std::vector<T>& ring, size_t wi, const T* in, size_t n) {
+    const size_t cap = ring.size();
+    const size_t first = std::min(n, cap - wi);
+    std::memcpy(ring.data() + wi, in, first * sizeof(T));
+    if (first < n) std::memcpy(ring.data(), in + first, (n - first) * sizeof(T));
+}
+
+// The last `count` samples written, oldest first, ending at `wi`.
+template <typename T>
+std::vector<T> readRing(const std::vector<T>& ring, size_t wi, size_t count) {
+    const size_t cap = ring.size();
+    std::vector<T> out(count);
+    const size_t start = (wi + cap - (count % cap)) % cap;
+    if (start + count <= cap) {
+        std::memcpy(out.data(), ring.data() + start, count * sizeof(T));
+    } else {
+        const size_t first = cap - start;
+        std::memcpy(out.data(), ring.data() + start, first * sizeof(T));
+        std::memcpy(out.data() + first, ring.data(), (count - first) * sizeof(T));
+    }
+    return out;
+}
+}
 
 AudioRecorder::AudioRecorder() : stream(nullptr), recording(false) {}
 
 AudioRecorder::~AudioRecorder() {
+    if (recording) stopRecording();
     if (stream) {
         Pa_CloseStream(stream);
     }
@@ -50,23 +103,30 @@ bool AudioRecorder::initialize(int deviceId) {
     }
 
     inputParams.channelCount = channels;
-    inputParams.sampleFormat = paFloat32;
     inputParams.suggestedLatency = Pa_GetDeviceInfo(inputParams.device)->defaultLowInputLatency;
     inputParams.hostApiSpecificStreamInfo = nullptr;
 
-    err = Pa_OpenStream(&stream,
-                        &inputParams,
-                        nullptr,
-                        sampleRate,
-                        framesPerBuffer,
-                        paClipOff,
-                        audioCallback,
-                        this);
-
+    auto open = [&](PaSampleFormat format) {
+        inputParams.sampleFormat = format;
+        return Pa_OpenStream(&stream, &inputParams, nullptr, sampleRate, framesPerBuffer,
+                             paClipOff, audioCallback, this);
+    };
+    int16_ = constants::kCaptureInt16;
+    if (int16_ && (err = open(paInt16)) != paNoError) {
+        std::cout << "[rose] int16 capture unavailable, using float32\n";
+        int16_ = false;
+    }
+    if (!int16_) err = open(paFloat32);
     if (err != paNoError) return false;
 
     capacity_ = static_cast<size_t>(sampleRate * constants::kMaxRecordingSeconds * channels);
-    ringBuffer_.assign(capacity_, 0.0f);
+    if (int16_) {
+        ring16_.assign(capacity_, 0);
+        ringBuffer_.clear();
+    } else {
+        ringBuffer_.assign(capacity_, 0.0f);
+        ring16_.clear();
+    }
     write_index_.store(0, std::memory_order_relaxed);
     total_written_.store(0, std::memory_order_relaxed);
     return true;
@@ -79,51 +139,232 @@ void AudioRecorder::startRecording() {
         {
             std::lock_guard<std::mutex> lk(prepare_mutex_);
             last_capture_.clear();
+            last_capture16_.clear();
+            last_spill_.reset();
         }
+        endpointed_ = false;
+        spill_.reset();
+        spilled_ = 0;
+        spill_stopped_ = false;
+        spilling_ = false;
         recording = true;
         if (PaError err = Pa_StartStream(stream); err != paNoError) {
             recording = false;
             std::cerr << "[rose] pa start failed: " << err << "\n";
+            return;
+        }
+        if (const int ms = endpoint_ms_.load(); ms > constants::kEndpointOff) {
+            endpoint_thread_ = std::thread([this, ms] { endpointLoop(ms); });
+        }
+        spill_thread_ = std::thread([this] { spillLoop(); });
+    }
+}
+
+bool AudioRecorder::spillUpTo(size_t end) {
+    static const int16_t kSilence[1024] = {};
+    const size_t total = total_written_.load(std::memory_order_acquire);
+    while (spilled_ < end) {
+        size_t n;
+        bool ok;
+        if (spilled_ + capacity_ < total) {
+            n = std::min({ end - spilled_, total - capacity_ - spilled_, std::size(kSilence) });
+            g_dropped_samples.add(n);
+            ok = spill_->append(kSilence, n);
+        } else if (const size_t at = spilled_ % capacity_; int16_) {
+            n = std::min(end - spilled_, capacity_ - at);
+            ok = spill_->append(ring16_.data() + at, n);
+        } else {
+            n = std::min({ end - spilled_, capacity_ - at, spill_scratch_.size() });
+            audio::float_to_int16(ringBuffer_.data() + at, n, spill_scratch_.data());
+            ok = spill_->append(spill_scratch_.data(), n);
+        }
+        if (!ok) return false;
+        spilled_ += n;
+    }
+    return true;
+}
+
+// Follows the ring like endpointLoop. Once the recording outgrows
+// kSpillStartSeconds, sealed chunks go to disk well before the ring wraps
+// over them.
+void AudioRecorder::spillLoop() {
+    trace::setThreadName("spill");
+    const size_t per_second = static_cast<size_t>(sampleRate) * channels;
+    const size_t chunk = per_second * constants::kSpillChunkSeconds;
+    std::unique_lock<std::mutex> lk(spill_mutex_);
+    while (!spill_cv_.wait_for(lk, std::chrono::milliseconds(constants::kSpillPollMs),
+                               [this] { return !recording.load(); })) {
+        const size_t total = total_written_.load(std::memory_order_acquire);
+        if (!spill_) {
+            if (total < per_second * constants::kSpillStartSeconds) continue;
+            auto store = std::make_unique<audio::SpillStore>(tempDir(), per_second * constants::kSpillMaxSeconds);
+            std::string error;
+            if (!store->open(&error)) {
+                std::cerr << "[rose] long recording kept to the last " << constants::kMaxRecordingSeconds
+                          << " s: " << error << "\n";
+                return;
+            }
+            if (!int16_) spill_scratch_.resize(chunk);
+            spill_ = std::move(store);
+            spilling_ = true;
+            std::cout << "[rose] long recording: spilling to disk\n";
+        }
+        trace::Span span("spill", static_cast<int64_t>(total - spilled_));
+        while (total - spilled_ >= chunk) {
+            if (!spillUpTo(spilled_ + chunk)) {
+                std::cerr << "[rose] capture store " << (spill_->full() ? "full" : "write failed")
+                          << " at " << spilled_ / per_second << " s; recording kept to that point\n";
+                spill_stopped_ = true;
+                return;
+            }
+        }
+    }
+}
+
+std::unique_ptr<audio::SpillStore> AudioRecorder::takeSpilledCapture() {
+    std::lock_guard<std::mutex> lk(prepare_mutex_);
+    return std::move(last_spill_);
+}
+
+void AudioRecorder::setEndpointing(int silenceMs, std::function<void()> onEndpoint) {
+    // The watcher reads on_endpoint_ unlocked; only swap it while idle.
+    if (!recording) on_endpoint_ = std::move(onEndpoint);
+    endpoint_ms_.store(std::max(constants::kEndpointOff, silenceMs));
+}
+
+// Follows the capture ring a poll interval behind the audio callback.
+void AudioRecorder::endpointLoop(int silenceMs) {
+    trace::setThreadName("endpoint");
+    audio::Endpointer endpointer(sampleRate, silenceMs);
+    std::vector<float> scratch(int16_ ? static_cast<size_t>(framesPerBuffer) * channels : 0);
+    size_t read = 0;
+    std::unique_lock<std::mutex> lk(endpoint_mutex_);
+    while (!endpoint_cv_.wait_for(lk, std::chrono::milliseconds(constants::kEndpointPollMs),
+                                  [this] { return !recording.load(); })) {
+        const size_t total = total_written_.load(std::memory_order_acquire);
+        // Anything the ring already overwrote is skipped; the endpointer only
+        // needs the recent past.
+        if (total - read > capacity_) read = total - capacity_;
+        bool fired = false;
+        while (read < total && !fired) {
+            const size_t at = read % capacity_;
+            size_t n = std::min(total - read, capacity_ - at);
+            if (int16_) {
+                n = std::min(n, scratch.size());
+                audio::int16_to_float(ring16_.data() + at, n, 1.0f, scratch.data());
+                fired = endpointer.push(scratch.data(), n);
+            } else {
+                fired = endpointer.push(ringBuffer_.data() + at, n);
+            }
+            read += n;
+        }
+        if (fired) {
+            endpoint_end_ = endpointer.speechEnd();
+            endpointed_ = true;
+            g_endpoint_stops.add();
+            trace::instant("endpoint", static_cast<int64_t>(endpoint_end_));
+            lk.unlock();
+            if (on_endpoint_) on_endpoint_();
+            return;
         }
     }
 }
 
 void AudioRecorder::stopRecording() {
     if (recording) {
-        recording = false;
+        {
+            std::lock_guard<std::mutex> lk(endpoint_mutex_);
+            recording = false;
+        }
+        { std::lock_guard<std::mutex> lk(spill_mutex_); }
+        endpoint_cv_.notify_all();
+        spill_cv_.notify_all();
+        if (endpoint_thread_.joinable()) endpoint_thread_.join();
+        if (spill_thread_.joinable()) spill_thread_.join();
         if (PaError err = Pa_StopStream(stream); err != paNoError) {
             std::cerr << "[rose] pa stop failed: " << err << "\n";
         }
         const size_t total = total_written_.load(std::memory_order_relaxed);
         const size_t count = std::min(capacity_, total);
+        const size_t per_second = static_cast<size_t>(sampleRate) * channels;
+        if (spill_) {
+            // The rest of the ring joins what was spilled, up to the endpoint
+            // tail if one was reached.
+            size_t end = total;
+            if (endpointed_) end = std::min(total, endpoint_end_ + per_second * constants::kEndpointTailMs / 1000);
+            if (!spill_stopped_ && end > spilled_) (void)spillUpTo(end);
+            spill_->truncate(end);
+            spilling_ = false;
+            if (spill_->seal()) {
+                std::cout << "[rose] long recording: " << spill_->size() / per_second << " s on disk\n";
+                std::lock_guard<std::mutex> lk(prepare_mutex_);
+                last_spill_ = std::move(spill_);
+                last_capture_.clear();
+                last_capture16_.clear();
+                return;
+            }
+            std::cerr << "[rose] cannot map the capture store; keeping the last "
+                      << constants::kMaxRecordingSeconds << " s\n";
+            spill_.reset();
+        }
+        if (total > capacity_) {
+            std::cout << "[rose] recording exceeded " << constants::kMaxRecordingSeconds
+                      << " s; dropped the first "
+                      << static_cast<double>(total - capacity_) / (sampleRate * channels) << " s\n";
+        }
         const size_t wi = write_index_.load(std::memory_order_relaxed);
         if (count > 0 && capacity_ > 0) {
+            // After an endpoint, drop the pause that triggered it (and anything
+            // captured while the stop was on its way) past a short tail.
+            size_t keep = count;
+            if (endpointed_) {
+                const size_t keep_until = std::min(total, endpoint_end_ + sampleRate * channels * constants::kEndpointTailMs / 1000);
+                const size_t first_kept = total - count;
+                if (keep_until > first_kept && keep_until < total) {
+                    std::cout << "[rose] endpoint: trimmed "
+                              << (total - keep_until) * 1000 / (sampleRate * channels) << " ms of trailing silence\n";
+                    keep = keep_until - first_kept;
+                }
+            }
+            std::vector<int16_t> tmp16;
             std::vector<float> tmp;
-            tmp.resize(count);
-            const size_t start = (wi + capacity_ - (count % capacity_)) % capacity_;
-            if (start + count <= capacity_) {
-                std::memcpy(tmp.data(), ringBuffer_.data() + start, count * sizeof(float));
+            if (int16_) {
+                tmp16 = readRing(ring16_, wi, count);
+                tmp16.resize(keep);
             } else {
-                const size_t first = capacity_ - start;
-                std::memcpy(tmp.data(), ringBuffer_.data() + start, first * sizeof(float));
-                std::memcpy(tmp.data() + first, ringBuffer_.data(), (count - first) * sizeof(float));
+                tmp = readRing(ringBuffer_, wi, count);
+                tmp.resize(keep);
             }
             {
                 std::lock_guard<std::mutex> lk(prepare_mutex_);
+                last_capture16_.swap(tmp16);
                 last_capture_.swap(tmp);
             }
         } else {
             std::lock_guard<std::mutex> lk(prepare_mutex_);
             last_capture_.clear();
+            last_capture16_.clear();
         }
     }
 }
 
 std::vector<float> AudioRecorder::getAudioData() {
     std::vector<float> data;
+    std::vector<int16_t> data16;
     {
         std::lock_guard<std::mutex> lk(prepare_mutex_);
         data.swap(last_capture_);
+        data16.swap(last_capture16_);
+    }
+
+    // int16 capture: peak scan, then conversion, auto-gain and clamp in one pass.
+    if (!data16.empty()) {
+        const float maxAmp = static_cast<float>(audio::peak_int16(data16.data(), data16.size())) / 32768.0f;
+        const float gain = maxAmp > 0.0f && maxAmp < constants::kAutoGainThreshold
+            ? constants::kAutoGainTarget / maxAmp : 1.0f;
+        data.resize(data16.size());
+        audio::int16_to_float(data16.data(), data16.size(), gain, data.data());
+        return data;
     }
 
     float maxAmp = 0.0f;
@@ -151,31 +392,43 @@ int AudioRecorder::audioCallback(const void* input, void* output,
                                  void* userData) {
     (void)output;
     (void)timeInfo;
-    (void)statusFlags;
 
     AudioRecorder* recorder = static_cast<AudioRecorder*>(userData);
     if (!recorder->recording) {
         return paContinue;
     }
+    if (statusFlags & paInputOverflow) g_input_overflows.add();
 
     if (!input) return paContinue;
-    const float* inputData = static_cast<const float*>(input);
+
+    // Only the first traced callback allocates (this thread's event ring).
+    static thread_local bool named = false;
+    if (!named) {
+        trace::setThreadName("audio");
+        if (!sched::apply(sched::Role::Audio)) g_audio_priority_denied.add();
+        named = true;
+    }
+    trace::Span span("audio.callback", static_cast<int64_t>(frameCount));
+
     const size_t n = static_cast<size_t>(frameCount) * static_cast<size_t>(channels);
 
-    if (recorder->capacity_ == 0 || recorder->ringBuffer_.empty()) {
+    if (recorder->capacity_ == 0) {
         return paContinue;
     }
 
     size_t wi = recorder->write_index_.load(std::memory_order_relaxed);
     const size_t cap = recorder->capacity_;
 
-    size_t first = std::min(n, cap - (wi % cap));
-    std::memcpy(recorder->ringBuffer_.data() + (wi % cap), inputData, first * sizeof(float));
-    if (first < n) {
-        std::memcpy(recorder->ringBuffer_.data(), inputData + first, (n - first) * sizeof(float));
+    if (recorder->int16_) {
+        writeRing(recorder->ring16_, wi % cap, static_cast<const int16_t*>(input), n);
+    } else {
+        writeRing(recorder->ringBuffer_, wi % cap, static_cast<const float*>(input), n);
     }
     recorder->write_index_.store((wi + n) % cap, std::memory_order_relaxed);
-    recorder->total_written_.fetch_add(n, std::memory_order_relaxed);
+    const size_t before = recorder->total_written_.fetch_add(n, std::memory_order_release);
+    if (before + n > cap && !recorder->spilling_.load(std::memory_order_relaxed)) {
+        g_dropped_samples.add(std::min(n, before + n - cap));
+    }
 
     return paContinue;
 }
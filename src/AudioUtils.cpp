@@ -2,9 +2,87 @@
 
 #include <algorithm>
 #include <cmath>
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace audio {
 
+int peak_int16(const int16_t* in, size_t n) {
+    int hi = 0, lo = 0;
+    size_t i = 0;
+#if defined(__aarch64__)
+    int16x8_t vhi = vdupq_n_s16(0), vlo = vdupq_n_s16(0);
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t x = vld1q_s16(in + i);
+        vhi = vmaxq_s16(vhi, x);
+        vlo = vminq_s16(vlo, x);
+    }
+    hi = vmaxvq_s16(vhi);
+    lo = vminvq_s16(vlo);
+#elif defined(__SSE2__)
+    __m128i vhi = _mm_setzero_si128(), vlo = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        vhi = _mm_max_epi16(vhi, x);
+        vlo = _mm_min_epi16(vlo, x);
+    }
+    alignas(16) int16_t h[8], l[8];
+    _mm_store_si128(reinterpret_cast<__m128i*>(h), vhi);
+    _mm_store_si128(reinterpret_cast<__m128i*>(l), vlo);
+    for (int k = 0; k < 8; ++k) {
+        hi = std::max<int>(hi, h[k]);
+        lo = std::min<int>(lo, l[k]);
+    }
+#endif
+    for (; i < n; ++i) {
+        hi = std::max<int>(hi, in[i]);
+        lo = std::min<int>(lo, in[i]);
+    }
+    return std::max(hi, -lo);
+}
+
+void int16_to_float(const int16_t* in, size_t n, float gain, float* out) {
+    const float scale = gain / 32768.0f;
+    size_t i = 0;
+#if defined(__aarch64__)
+    const float32x4_t vscale = vdupq_n_f32(scale);
+    const float32x4_t one = vdupq_n_f32(1.0f), minus_one = vdupq_n_f32(-1.0f);
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t x = vld1q_s16(in + i);
+        float32x4_t a = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), vscale);
+        float32x4_t b = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), vscale);
+        vst1q_f32(out + i, vmaxq_f32(vminq_f32(a, one), minus_one));
+        vst1q_f32(out + i + 4, vmaxq_f32(vminq_f32(b, one), minus_one));
+    }
+#elif defined(__SSE2__)
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 one = _mm_set1_ps(1.0f), minus_one = _mm_set1_ps(-1.0f);
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Interleave with itself, then shift: sign-extends each lane to 32 bits.
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        const __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale);
+        const __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale);
+        _mm_storeu_ps(out + i, _mm_max_ps(_mm_min_ps(a, one), minus_one));
+        _mm_storeu_ps(out + i + 4, _mm_max_ps(_mm_min_ps(b, one), minus_one));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = std::max(-1.0f, std::min(1.0f, static_cast<float>(in[i]) * scale));
+    }
+}
+
+void float_to_int16(const float* in, size_t n, int16_t* out) {
+    for (size_t i = 0; i < n; ++i) {
+        const float v = std::max(-1.0f, std::min(1.0f, in[i])) * 32767.0f;
+        out[i] = static_cast<int16_t>(std::lround(v));
+    }
+}
+
 std::vector<float> trim_silence(const std::vector<float>& audio,
                                 int sample_rate,
                                 float rms_threshold) {
@@ -25,6 +103,67 @@ std::vector<float> trim_silence(const std::vector<float>& audio,
     return std::vector<float>(audio.begin() + L, audio.begin() + R);
 }
 
+size_t OffsetMap::original(size_t compacted) const {
+    auto it = std::upper_bound(anchors_.begin(), anchors_.end(), compacted,
+                               [](size_t c, const std::pair<size_t, size_t>& a) { return c < a.first; });
+    if (it == anchors_.begin()) return compacted;
+    --it;
+    return it->second + (compacted - it->first);
+}
+
+int64_t OffsetMap::originalMs(int64_t compacted_ms, int sample_rate) const {
+    if (anchors_.empty() || compacted_ms <= 0) return compacted_ms;
+    const size_t sample = static_cast<size_t>(compacted_ms * sample_rate / 1000);
+    return static_cast<int64_t>(original(sample)) * 1000 / sample_rate;
+}
+
+Compacted compact_pauses(const std::vector<float>& audio,
+                         int sample_rate,
+                         int frame_ms,
+                         int min_pause_ms,
+                         int keep_ms,
+                         float relative_rms,
+                         float quiet_rms) {
+    Compacted out;
+    const size_t frame = static_cast<size_t>(std::max(1, sample_rate * frame_ms / 1000));
+    const size_t n_frames = audio.size() / frame;
+    if (n_frames < 3) return out;
+
+    std::vector<float> rms(n_frames);
+    float loudest = 0.0f;
+    for (size_t f = 0; f < n_frames; ++f) {
+        double e = 0.0;
+        for (size_t i = f * frame; i < (f + 1) * frame; ++i) e += static_cast<double>(audio[i]) * audio[i];
+        rms[f] = static_cast<float>(std::sqrt(e / static_cast<double>(frame)));
+        loudest = std::max(loudest, rms[f]);
+    }
+    const float threshold = std::min(quiet_rms, loudest * relative_rms);
+    const size_t min_pause = static_cast<size_t>(std::max(1, min_pause_ms / std::max(1, frame_ms)));
+    const size_t half_keep = static_cast<size_t>(sample_rate) * static_cast<size_t>(std::max(0, keep_ms)) / 2000;
+
+    size_t copied = 0;   // original samples up to here are settled
+    size_t f = 0;
+    while (f < n_frames && rms[f] < threshold) ++f;   // leading silence stays
+    while (f < n_frames) {
+        if (rms[f] >= threshold) { ++f; continue; }
+        size_t end = f;
+        while (end < n_frames && rms[end] < threshold) ++end;
+        if (end == n_frames) break;                     // trailing silence stays
+        if (end - f > min_pause && (end - f) * frame > 2 * half_keep) {
+            const size_t cut_from = f * frame + half_keep;
+            const size_t cut_to = end * frame - half_keep;
+            if (out.audio.empty()) out.audio.reserve(audio.size());
+            out.audio.insert(out.audio.end(), audio.begin() + copied, audio.begin() + cut_from);
+            out.offsets.add(out.audio.size(), cut_to);
+            copied = cut_to;
+        }
+        f = end;
+    }
+    if (out.offsets.empty()) return out;
+    out.audio.insert(out.audio.end(), audio.begin() + copied, audio.end());
+    return out;
+}
+
 std::vector<float> apply_high_pass_filter(const std::vector<float>& audio,
                                           int sample_rate,
                                           float cutoff_hz) {
@@ -0,0 +1,96 @@
+#include "Calibration.h"
+#include "Constants.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+namespace calibration {
+
+namespace {
+
+int family_rank(const std::string& family) {
+    static const char* kOrder[] = {"tiny", "base", "small", "medium", "large"};
+    for (int i = 0; i < 5; ++i) {
+        if (family == kOrder[i]) return i;
+    }
+    return -1;
+}
+
+} // namespace
+
+double predict_ms(const ModelProfile& p, int candidates, unsigned hw_threads) {
+    const double single = p.encode_ms + p.decode_ms_per_token * constants::kCalibrationExpectedTokens;
+    // Candidates beyond the available cores time-share them.
+    const double demand = static_cast<double>(std::max(1, candidates)) * std::max(1, p.threads);
+    const double oversubscription = std::max(1.0, demand / std::max(1u, hw_threads));
+    return single * oversubscription;
+}
+
+bool choose(const std::vector<ModelProfile>& profiles,
+            double target_ms,
+            int candidates,
+            unsigned hw_threads,
+            Choice& out) {
+    if (profiles.empty()) return false;
+
+    const ModelProfile* best = nullptr;
+    double best_ms = 0.0;
+    const ModelProfile* fastest = nullptr;
+    double fastest_ms = 0.0;
+    for (const auto& p : profiles) {
+        if (family_rank(p.family) < 0) continue;
+        const double ms = predict_ms(p, candidates, hw_threads);
+        if (!fastest || ms < fastest_ms) { fastest = &p; fastest_ms = ms; }
+        if (ms > target_ms) continue;
+        const int rank = family_rank(p.family);
+        if (!best || rank > family_rank(best->family) ||
+            (rank == family_rank(best->family) && ms < best_ms)) {
+            best = &p;
+            best_ms = ms;
+        }
+    }
+    if (!fastest) return false;
+
+    const ModelProfile* pick = best ? best : fastest;
+    out.family = pick->family;
+    out.threads = pick->threads;
+    out.predicted_ms = best ? best_ms : fastest_ms;
+    out.meets_target = best != nullptr;
+    return true;
+}
+
+std::string serialize(const ModelProfile& p) {
+    char buf[128];
+    std::snprintf(buf, sizeof buf, "%s,%d,%.3f,%.4f",
+                  p.family.c_str(), p.threads, p.encode_ms, p.decode_ms_per_token);
+    return buf;
+}
+
+bool parse(const std::string& line, ModelProfile& out) {
+    std::istringstream in(line);
+    std::string family, threads, enc, dec;
+    if (!std::getline(in, family, ',') || !std::getline(in, threads, ',') ||
+        !std::getline(in, enc, ',') || !std::getline(in, dec)) {
+        return false;
+    }
+    try {
+        out.family = family;
+        out.threads = std::stoi(threads);
+        out.encode_ms = std::stod(enc);
+        out.decode_ms_per_token = std::stod(dec);
+    } catch (...) {
+        return false;
+    }
+    return family_rank(out.family) >= 0 && out.threads > 0 && out.encode_ms > 0.0;
+}
+
+std::vector<int> thread_candidates(unsigned hw_threads) {
+    const int hw = static_cast<int>(std::max(1u, hw_threads));
+    std::vector<int> out;
+    for (int t = 1; t <= hw && t <= constants::kCalibrationMaxThreads; t *= 2) out.push_back(t);
+    if (hw <= constants::kCalibrationMaxThreads && out.back() != hw) out.push_back(hw);
+    return out;
+}
+
+} // namespace calibration
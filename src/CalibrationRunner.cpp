@@ -0,0 +1,91 @@
+#include "Calibration.h"
+#include "Constants.h"
+#include "WhisperContext.h"
+#include "whisper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace calibration {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+int argmax(const float* logits, int n) {
+    return static_cast<int>(std::max_element(logits, logits + n) - logits);
+}
+
+// Times one encoder pass over a full window and a short greedy decoder run.
+bool measure(WhisperContext& ctx, whisper_state* state, const std::vector<float>& pcm,
+             int threads, ModelProfile& out) {
+    whisper_context* wctx = ctx.get();
+    if (whisper_pcm_to_mel_with_state(wctx, state, pcm.data(), static_cast<int>(pcm.size()), threads) != 0) {
+        return false;
+    }
+
+    auto t0 = Clock::now();
+    if (whisper_encode_with_state(wctx, state, 0, threads) != 0) return false;
+    out.encode_ms = ms_since(t0);
+
+    // Prompt first, then one token per step as whisper_full does.
+    whisper_token token = whisper_token_sot(wctx);
+    if (whisper_decode_with_state(wctx, state, &token, 1, 0, threads) != 0) return false;
+    const int n_vocab = whisper_n_vocab(wctx);
+    const int steps = constants::kCalibrationDecodeSteps;
+    t0 = Clock::now();
+    for (int i = 0; i < steps; ++i) {
+        token = argmax(whisper_get_logits_from_state(state), n_vocab);
+        if (whisper_decode_with_state(wctx, state, &token, 1, i + 1, threads) != 0) return false;
+    }
+    out.decode_ms_per_token = ms_since(t0) / steps;
+    out.threads = threads;
+    return true;
+}
+
+} // namespace
+
+std::vector<ModelProfile> run(const std::vector<std::pair<std::string, std::string>>& family_paths,
+                              bool use_gpu,
+                              const std::function<void(const std::string&)>& progress) {
+    std::vector<ModelProfile> profiles;
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+
+    // Speech-like energy keeps the decoder from hitting end-of-text immediately.
+    std::vector<float> pcm(static_cast<size_t>(constants::kSampleRate) * 5);
+    uint32_t seed = 0x2545f491u;
+    for (float& s : pcm) {
+        seed = seed * 1664525u + 1013904223u;
+        s = (static_cast<float>(seed >> 8) / static_cast<float>(1u << 24) - 0.5f) * 0.1f;
+    }
+
+    for (const auto& fp : family_paths) {
+        WhisperContext ctx;
+        if (!ctx.initialize(fp.second, use_gpu)) {
+            if (progress) progress(fp.first + ": load failed");
+            continue;
+        }
+        auto state = ctx.acquireState();
+        if (!state) continue;
+
+        // Untimed pass to pay first-call costs.
+        ModelProfile scratch;
+        (void)measure(ctx, state.get(), pcm, constants::kWhisperThreads, scratch);
+
+        for (int threads : thread_candidates(hw)) {
+            ModelProfile p;
+            p.family = fp.first;
+            if (!measure(ctx, state.get(), pcm, threads, p)) continue;
+            if (progress) progress(serialize(p));
+            profiles.push_back(p);
+        }
+    }
+    return profiles;
+}
+
+} // namespace calibration
@@ -0,0 +1,92 @@
+#include "ClipPacking.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace packing {
+
+namespace {
+
+int64_t samples_to_ms(size_t samples, int sample_rate) {
+    return static_cast<int64_t>(samples) * 1000 / sample_rate;
+}
+
+int64_t overlap(int64_t a0, int64_t a1, int64_t b0, int64_t b1) {
+    return std::max<int64_t>(0, std::min(a1, b1) - std::max(a0, b0));
+}
+
+int64_t distance(int64_t t, const Span& s) {
+    if (t < s.start_ms) return s.start_ms - t;
+    if (t > s.end_ms) return t - s.end_ms;
+    return 0;
+}
+
+std::string trimmed(const std::string& s) {
+    size_t b = 0, e = s.size();
+    while (b < e && std::isspace(static_cast<unsigned char>(s[b]))) ++b;
+    while (e > b && std::isspace(static_cast<unsigned char>(s[e - 1]))) --e;
+    return s.substr(b, e - b);
+}
+
+} // namespace
+
+std::vector<Window> pack(const std::vector<std::vector<float>>& clips,
+                         int sample_rate,
+                         int window_ms,
+                         int gap_ms,
+                         size_t max_clips) {
+    const size_t window = static_cast<size_t>(window_ms) * sample_rate / 1000;
+    const size_t gap = static_cast<size_t>(gap_ms) * sample_rate / 1000;
+
+    std::vector<Window> windows;
+    Window current;
+    auto flush = [&] {
+        if (!current.spans.empty()) windows.push_back(std::move(current));
+        current = Window{};
+    };
+
+    for (size_t i = 0; i < clips.size(); ++i) {
+        const auto& clip = clips[i];
+        if (clip.empty()) continue;
+        const size_t needed = current.audio.size() + clip.size();
+        if (!current.spans.empty() && (needed > window || current.spans.size() >= max_clips)) flush();
+
+        const size_t start = current.audio.size();
+        current.audio.insert(current.audio.end(), clip.begin(), clip.end());
+        current.spans.push_back(Span{ i, samples_to_ms(start, sample_rate),
+                                      samples_to_ms(start + clip.size(), sample_rate) });
+        current.audio.resize(current.audio.size() + gap, 0.0f);
+    }
+    flush();
+    return windows;
+}
+
+std::vector<std::string> split(const std::vector<TranscriptSegment>& segments,
+                               const std::vector<Span>& spans) {
+    std::vector<std::string> texts(spans.size());
+    if (spans.empty()) return texts;
+
+    for (const auto& seg : segments) {
+        const std::string text = trimmed(seg.text);
+        if (text.empty()) continue;
+
+        size_t best = 0;
+        int64_t best_overlap = -1;
+        int64_t best_distance = INT64_MAX;
+        const int64_t mid = (seg.t0_ms + seg.t1_ms) / 2;
+        for (size_t s = 0; s < spans.size(); ++s) {
+            const int64_t o = overlap(seg.t0_ms, seg.t1_ms, spans[s].start_ms, spans[s].end_ms);
+            const int64_t d = distance(mid, spans[s]);
+            if (o > best_overlap || (o == best_overlap && d < best_distance)) {
+                best = s;
+                best_overlap = o;
+                best_distance = d;
+            }
+        }
+        if (!texts[best].empty()) texts[best] += ' ';
+        texts[best] += text;
+    }
+    return texts;
+}
+
+} // namespace packing
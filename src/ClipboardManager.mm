@@ -10,3 +10,37 @@ void ClipboardManager::copyToClipboard(const std::string& text) {
         [pasteboard setString:nsText forType:NSPasteboardTypeString];
     }
 }
+
+std::string ClipboardManager::readClipboard() {
+    @autoreleasepool {
+        NSString* nsText = [[NSPasteboard generalPasteboard] stringForType:NSPasteboardTypeString];
+        return nsText ? std::string([nsText UTF8String]) : std::string();
+    }
+}
+
+void ClipboardSink::partial(int seq, const std::string& text) {
+    if (text.empty()) return;
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (seq != seq_) {
+        saved_ = ClipboardManager::readClipboard();
+        seq_ = seq;
+    }
+    ClipboardManager::copyToClipboard(text);
+}
+
+void ClipboardSink::commit(int seq, const std::string& text) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!text.empty()) {
+        ClipboardManager::copyToClipboard(text);
+    } else if (seq == seq_) {
+        if (saved_.empty()) {
+            [[NSPasteboard generalPasteboard] clearContents];
+        } else {
+            ClipboardManager::copyToClipboard(saved_);
+        }
+    }
+    if (seq == seq_) {
+        seq_ = -1;
+        saved_.clear();
+    }
+}
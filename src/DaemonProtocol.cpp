@@ -0,0 +1,240 @@
+#include "DaemonProtocol.h"
+#include "AudioFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace ipc {
+
+namespace {
+
+const unsigned char kMagic[4] = { 'R', 'O', 'S', 'E' };
+constexpr size_t kLanguageBytes = 8;
+
+void put_u16(unsigned char* p, uint16_t v) {
+    p[0] = static_cast<unsigned char>(v);
+    p[1] = static_cast<unsigned char>(v >> 8);
+}
+void put_u32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+uint16_t get_u16(const unsigned char* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t get_u32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+bool fail(std::string* error, const std::string& msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+bool check_magic(const unsigned char* header, std::string* error) {
+    if (std::memcmp(header, kMagic, 4) != 0) return fail(error, "bad magic");
+    if (get_u16(header + 4) != kVersion) return fail(error, "unsupported protocol version");
+    return true;
+}
+
+bool read_exact(int fd, void* buf, size_t n) {
+    auto* p = static_cast<unsigned char*>(buf);
+    while (n > 0) {
+        const ssize_t r = ::read(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+bool unix_address(const std::string& path, sockaddr_un& addr, std::string* error) {
+    std::memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr.sun_path) return fail(error, "socket path too long: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+} // namespace
+
+const char* status_name(Status status) {
+    switch (status) {
+        case Status::Ok: return "ok";
+        case Status::BadRequest: return "bad request";
+        case Status::DecodeFailed: return "decode failed";
+        case Status::Busy: return "busy";
+        case Status::Unavailable: return "unavailable";
+    }
+    return "unknown";
+}
+
+std::vector<unsigned char> encode_request(const Request& request) {
+    std::vector<unsigned char> out(kRequestHeaderSize + request.payload.size(), 0);
+    unsigned char* h = out.data();
+    std::memcpy(h, kMagic, 4);
+    put_u16(h + 4, kVersion);
+    put_u16(h + 6, static_cast<uint16_t>(request.format));
+    put_u32(h + 8, request.sample_rate);
+    put_u16(h + 12, request.best_of);
+    std::memcpy(h + 16, request.language.data(), std::min(request.language.size(), kLanguageBytes));
+    put_u32(h + 24, request.id);
+    put_u32(h + 28, static_cast<uint32_t>(request.payload.size()));
+    std::copy(request.payload.begin(), request.payload.end(), out.begin() + kRequestHeaderSize);
+    return out;
+}
+
+std::vector<unsigned char> encode_response(const Response& response) {
+    std::vector<unsigned char> out(kResponseHeaderSize + response.body.size());
+    unsigned char* h = out.data();
+    std::memcpy(h, kMagic, 4);
+    put_u16(h + 4, kVersion);
+    put_u16(h + 6, static_cast<uint16_t>(response.status));
+    put_u32(h + 8, response.id);
+    put_u32(h + 12, static_cast<uint32_t>(response.body.size()));
+    std::copy(response.body.begin(), response.body.end(), out.begin() + kResponseHeaderSize);
+    return out;
+}
+
+bool decode_request_header(const unsigned char* header, Request& out, uint32_t& payload_bytes,
+                           std::string* error) {
+    if (!check_magic(header, error)) return false;
+    const uint16_t format = get_u16(header + 6);
+    if (format < static_cast<uint16_t>(AudioFormat::PcmF32) || format > static_cast<uint16_t>(AudioFormat::Wav)) {
+        return fail(error, "unknown audio format " + std::to_string(format));
+    }
+    out.format = static_cast<AudioFormat>(format);
+    out.sample_rate = get_u32(header + 8);
+    out.best_of = get_u16(header + 12);
+    const char* lang = reinterpret_cast<const char*>(header + 16);
+    out.language.assign(lang, strnlen(lang, kLanguageBytes));
+    out.id = get_u32(header + 24);
+    payload_bytes = get_u32(header + 28);
+    if (payload_bytes > kMaxPayloadBytes) return fail(error, "payload too large");
+    return true;
+}
+
+bool decode_response_header(const unsigned char* header, Response& out, uint32_t& payload_bytes,
+                            std::string* error) {
+    if (!check_magic(header, error)) return false;
+    out.status = static_cast<Status>(get_u16(header + 6));
+    out.id = get_u32(header + 8);
+    payload_bytes = get_u32(header + 12);
+    if (payload_bytes > kMaxPayloadBytes) return fail(error, "payload too large");
+    return true;
+}
+
+bool decode_audio(const Request& request, int sample_rate, std::vector<float>& out, std::string* error) {
+    const auto& p = request.payload;
+    if (request.format == AudioFormat::Wav) {
+        return audio::decode_wav(p.data(), p.size(), sample_rate, out, error);
+    }
+
+    const int rate = request.sample_rate == 0 ? sample_rate : static_cast<int>(request.sample_rate);
+    if (rate < 1000 || rate > 384000) return fail(error, "unsupported sample rate");
+    std::vector<float> pcm;
+    if (request.format == AudioFormat::PcmF32) {
+        if (p.size() % 4 != 0) return fail(error, "float32 payload is not a whole number of samples");
+        pcm.resize(p.size() / 4);
+        for (size_t i = 0; i < pcm.size(); ++i) {
+            const uint32_t u = get_u32(p.data() + 4 * i);
+            std::memcpy(&pcm[i], &u, sizeof u);
+        }
+    } else {
+        if (p.size() % 2 != 0) return fail(error, "int16 payload is not a whole number of samples");
+        pcm.resize(p.size() / 2);
+        for (size_t i = 0; i < pcm.size(); ++i) {
+            pcm[i] = static_cast<int16_t>(get_u16(p.data() + 2 * i)) / 32768.0f;
+        }
+    }
+    out = audio::resample_linear(pcm, rate, sample_rate);
+    return true;
+}
+
+bool read_request(int fd, Request& out, std::string* error) {
+    unsigned char header[kRequestHeaderSize];
+    if (!read_exact(fd, header, sizeof header)) return fail(error, "connection closed");
+    uint32_t n = 0;
+    if (!decode_request_header(header, out, n, error)) return false;
+    out.payload.resize(n);
+    if (n > 0 && !read_exact(fd, out.payload.data(), n)) return fail(error, "truncated payload");
+    return true;
+}
+
+bool read_response(int fd, Response& out, std::string* error) {
+    unsigned char header[kResponseHeaderSize];
+    if (!read_exact(fd, header, sizeof header)) return fail(error, "connection closed");
+    uint32_t n = 0;
+    if (!decode_response_header(header, out, n, error)) return false;
+    out.body.resize(n);
+    if (n > 0 && !read_exact(fd, &out.body[0], n)) return fail(error, "truncated payload");
+    return true;
+}
+
+bool write_message(int fd, const std::vector<unsigned char>& bytes) {
+    const unsigned char* p = bytes.data();
+    size_t n = bytes.size();
+    while (n > 0) {
+        const ssize_t w = ::write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+std::string default_socket_path() {
+    if (const char* dir = std::getenv("XDG_RUNTIME_DIR"); dir && *dir) {
+        return std::string(dir) + "/rose.sock";
+    }
+    return "/tmp/rose-" + std::to_string(::getuid()) + ".sock";
+}
+
+int listen_unix(const std::string& path, std::string* error) {
+    sockaddr_un addr;
+    if (!unix_address(path, addr, error)) return -1;
+
+    // Refuse to steal the socket from a live daemon; remove a stale one.
+    const int probe = connect_unix(path);
+    if (probe >= 0) {
+        ::close(probe);
+        fail(error, "another daemon is listening on " + path);
+        return -1;
+    }
+    ::unlink(path.c_str());
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fail(error, std::string("socket: ") + std::strerror(errno));
+        return -1;
+    }
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof addr) != 0 || ::listen(fd, 64) != 0) {
+        fail(error, "bind " + path + ": " + std::strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int connect_unix(const std::string& path, std::string* error) {
+    sockaddr_un addr;
+    if (!unix_address(path, addr, error)) return -1;
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fail(error, std::string("socket: ") + std::strerror(errno));
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof addr) != 0) {
+        fail(error, "connect " + path + ": " + std::strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace ipc
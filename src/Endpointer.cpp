@@ -0,0 +1,53 @@
+#include "Endpointer.h"
+#include "Constants.h"
+
+#include <algorithm>
+
+namespace audio {
+
+Endpointer::Endpointer(int sample_rate, int silence_ms)
+    : frame_len_(static_cast<size_t>(std::max(1, sample_rate * constants::kEndpointFrameMs / 1000))),
+      silence_frames_(std::max(1, silence_ms / constants::kEndpointFrameMs)),
+      min_speech_frames_(std::max(1, constants::kEndpointMinSpeechMs / constants::kEndpointFrameMs)) {}
+
+void Endpointer::reset() {
+    energy_ = 0.0;
+    in_frame_ = 0;
+    consumed_ = 0;
+    floor_ = 0.0f;
+    speech_frames_ = 0;
+    silence_run_ = 0;
+    speech_end_ = 0;
+    fired_ = false;
+}
+
+bool Endpointer::push(const float* samples, size_t count) {
+    for (size_t i = 0; i < count && !fired_; ++i) {
+        energy_ += static_cast<double>(samples[i]) * samples[i];
+        ++consumed_;
+        if (++in_frame_ == frame_len_) endFrame();
+    }
+    return fired_;
+}
+
+void Endpointer::endFrame() {
+    const float energy = static_cast<float>(energy_ / static_cast<double>(frame_len_));
+    energy_ = 0.0;
+    in_frame_ = 0;
+
+    // Scored against the floor from earlier frames, then the floor updates:
+    // straight down to a quieter frame, creeping up otherwise.
+    const float floor = floor_ > 0.0f ? floor_ : energy;
+    const bool speech = energy > std::max(constants::kEndpointMinEnergy, floor * constants::kEndpointSpeechRatio);
+    floor_ = std::max(1e-9f, std::min(energy, floor * constants::kEndpointFloorRise));
+
+    if (speech) {
+        ++speech_frames_;
+        silence_run_ = 0;
+        speech_end_ = consumed_;
+    } else if (speech_frames_ >= min_speech_frames_ && ++silence_run_ >= silence_frames_) {
+        fired_ = true;
+    }
+}
+
+} // namespace audio
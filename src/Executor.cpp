@@ -0,0 +1,198 @@
+#include "Executor.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace rose {
+
+namespace {
+
+constexpr size_t kInitialDequeCapacity = 64;
+// Tasks a serial queue runs before handing its worker back to the pool.
+constexpr int kSerialBatch = 32;
+
+thread_local Executor* tl_executor = nullptr;
+thread_local size_t tl_worker = 0;
+
+} // namespace
+
+TaskDeque::TaskDeque() : ring_(kInitialDequeCapacity) {}
+
+void TaskDeque::grow() {
+    std::vector<Task> bigger(ring_.size() * 2);
+    const size_t mask = ring_.size() - 1;
+    for (size_t i = 0; i < count_; ++i) {
+        bigger[i] = std::move(ring_[(head_ + i) & mask]);
+    }
+    ring_.swap(bigger);
+    head_ = 0;
+}
+
+void TaskDeque::push(Task&& t) {
+    lock();
+    if (count_ == ring_.size()) grow();
+    ring_[(head_ + count_) & (ring_.size() - 1)] = std::move(t);
+    ++count_;
+    unlock();
+}
+
+bool TaskDeque::pop(Task& out) {
+    lock();
+    if (count_ == 0) {
+        unlock();
+        return false;
+    }
+    --count_;
+    out = std::move(ring_[(head_ + count_) & (ring_.size() - 1)]);
+    unlock();
+    return true;
+}
+
+bool TaskDeque::steal(Task& out) {
+    lock();
+    if (count_ == 0) {
+        unlock();
+        return false;
+    }
+    out = std::move(ring_[head_]);
+    head_ = (head_ + 1) & (ring_.size() - 1);
+    --count_;
+    unlock();
+    return true;
+}
+
+size_t TaskDeque::size() const {
+    lock();
+    const size_t n = count_;
+    unlock();
+    return n;
+}
+
+Executor::Executor(unsigned threads, sched::Role role) : role_(role) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; ++i) deques_.push_back(std::make_unique<TaskDeque>());
+    for (unsigned i = 0; i < threads; ++i) workers_.emplace_back([this, i] { workerLoop(i); });
+}
+
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lk(sleep_mutex_);
+        stopping_.store(true);
+    }
+    sleep_cv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+Executor& Executor::shared() {
+    // Never destroyed: workers may still be decoding when the process exits.
+    static Executor* instance = new Executor(0, sched::Role::Decode);
+    return *instance;
+}
+
+void Executor::post(Task task) {
+    const size_t target = tl_executor == this
+        ? tl_worker
+        : next_.fetch_add(1, std::memory_order_relaxed) % deques_.size();
+    pending_.fetch_add(1);
+    deques_[target]->push(std::move(task));
+    // Paired with the sleepers_ increment in workerLoop: either the worker sees
+    // the pending task or we see the sleeper and wake it.
+    if (sleepers_.load() > 0) {
+        std::lock_guard<std::mutex> lk(sleep_mutex_);
+        sleep_cv_.notify_one();
+    }
+}
+
+bool Executor::tryTake(size_t self, Task& out) {
+    const size_t n = deques_.size();
+    if (deques_[self % n]->pop(out)) return true;
+    for (size_t i = 1; i < n; ++i) {
+        if (deques_[(self + i) % n]->steal(out)) return true;
+    }
+    return false;
+}
+
+bool Executor::runOne() {
+    const size_t self = tl_executor == this ? tl_worker : next_.load(std::memory_order_relaxed);
+    Task task;
+    if (!tryTake(self, task)) return false;
+    pending_.fetch_sub(1);
+    task();
+    return true;
+}
+
+void Executor::workerLoop(size_t index) {
+    tl_executor = this;
+    tl_worker = index;
+    trace::setThreadName("rose.worker");
+    (void)sched::apply(role_);
+    for (;;) {
+        Task task;
+        if (tryTake(index, task)) {
+            pending_.fetch_sub(1);
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lk(sleep_mutex_);
+        sleepers_.fetch_add(1);
+        sleep_cv_.wait(lk, [this] { return stopping_.load() || pending_.load() > 0; });
+        sleepers_.fetch_sub(1);
+        if (stopping_.load() && pending_.load() == 0) return;
+    }
+}
+
+SerialQueue::SerialQueue(const char* label, Executor& executor)
+    : label_(label), executor_(executor) {}
+
+SerialQueue::~SerialQueue() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    idle_cv_.wait(lk, [this] { return !scheduled_; });
+}
+
+void SerialQueue::async(Task task) {
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        tasks_.push(std::move(task));
+        if (!scheduled_) {
+            scheduled_ = true;
+            schedule = true;
+        }
+    }
+    if (schedule) executor_.post([this] { drain(); });
+}
+
+void SerialQueue::drain() {
+    for (int n = 0; n < kSerialBatch; ++n) {
+        Task task;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            if (!tasks_.steal(task)) {
+                scheduled_ = false;
+                idle_cv_.notify_all();
+                return;
+            }
+        }
+        task();
+    }
+    executor_.post([this] { drain(); });
+}
+
+void TaskGroup::finishOne() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (outstanding_.fetch_sub(1, std::memory_order_acq_rel) == 1) done_cv_.notify_all();
+}
+
+void TaskGroup::wait() {
+    while (outstanding_.load(std::memory_order_acquire) > 0) {
+        if (executor_.runOne()) continue;
+        std::unique_lock<std::mutex> lk(mutex_);
+        done_cv_.wait_for(lk, std::chrono::milliseconds(1),
+                          [this] { return outstanding_.load(std::memory_order_acquire) == 0; });
+    }
+    // The last task may still hold mutex_ while notifying.
+    std::lock_guard<std::mutex> lk(mutex_);
+}
+
+} // namespace rose
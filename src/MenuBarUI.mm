@@ -2,7 +2,10 @@
 #include "Settings.h"
 #include "Constants.h"
 #include "AudioRecorder.h"
+#include "ModelCatalog.h"
+#include "Trace.h"
 #include <Cocoa/Cocoa.h>
+#include <iostream>
 
 static NSMenu* BuildModelMenu(id target) {
     NSMenu* modelMenu = [[NSMenu alloc] init];
@@ -36,6 +39,68 @@ static NSMenu* BuildModelMenu(id target) {
     return modelMenu;
 }
 
+static NSMenu* BuildQuantizationMenu(id target) {
+    NSMenu* quantMenu = [[NSMenu alloc] init];
+    Settings& settings = Settings::getInstance();
+    const std::string family = Settings::modelFamily(settings.getEffectiveModel());
+    const std::string current = settings.getQuantization();
+
+    std::vector<models::ModelFile> found;
+    for (const auto& dir : models::search_directories()) {
+        auto more = models::discover(dir);
+        found.insert(found.end(), more.begin(), more.end());
+    }
+
+    for (const auto& opt : constants::QuantizationOptions()) {
+        bool present = opt.first == "auto";
+        for (const auto& m : found) {
+            if (models::size_family(m.size) == family && opt.first == models::quantization_name(m.quant)) {
+                present = true;
+                break;
+            }
+        }
+        NSString* title = [NSString stringWithUTF8String:opt.second.c_str()];
+        if (!present) title = [title stringByAppendingString:@" (not found)"];
+        NSString* value = [NSString stringWithUTF8String:opt.first.c_str()];
+        NSMenuItem* item = [[NSMenuItem alloc] initWithTitle:title action:@selector(setQuantization:) keyEquivalent:@""];
+        [item setTarget:target];
+        [item setRepresentedObject:value];
+        [item setState:(opt.first == current ? NSControlStateValueOn : NSControlStateValueOff)];
+        [quantMenu addItem:item];
+    }
+    return quantMenu;
+}
+
+static NSMenu* BuildLatencyMenu(id target) {
+    NSMenu* latencyMenu = [[NSMenu alloc] init];
+    Settings& settings = Settings::getInstance();
+    const int current = settings.getLatencyTargetMs();
+    for (const auto& opt : constants::LatencyTargetOptions()) {
+        NSString* title = [NSString stringWithUTF8String:opt.second.c_str()];
+        NSMenuItem* item = [[NSMenuItem alloc] initWithTitle:title action:@selector(setLatencyTarget:) keyEquivalent:@""];
+        [item setTarget:target];
+        [item setTag:opt.first];
+        [item setState:(opt.first == current ? NSControlStateValueOn : NSControlStateValueOff)];
+        [latencyMenu addItem:item];
+    }
+
+    [latencyMenu addItem:[NSMenuItem separatorItem]];
+    NSString* status = @"Not calibrated";
+    if (!settings.getCalibration().empty()) {
+        status = current == constants::kLatencyTargetOff
+            ? @"Calibrated"
+            : [NSString stringWithFormat:@"Using %s, %d threads",
+                  settings.getModelName().c_str(), settings.getDecodeThreads()];
+    }
+    [latencyMenu addItemWithTitle:status action:nil keyEquivalent:@""];
+    NSMenuItem* calibrateItem = [[NSMenuItem alloc] initWithTitle:@"Calibrate Hardware"
+                                                           action:@selector(calibrate:)
+                                                    keyEquivalent:@""];
+    [calibrateItem setTarget:target];
+    [latencyMenu addItem:calibrateItem];
+    return latencyMenu;
+}
+
 static NSMenu* BuildBestOfMenu(id target) {
     NSMenu* bestOfMenu = [[NSMenu alloc] init];
     int currentBestOfN = Settings::getInstance().getBestOfN();
@@ -132,16 +197,47 @@ static NSMenu* BuildLanguageMenu(id target) {
     return languageMenu;
 }
 
+static NSMenu* BuildEndpointMenu(id target) {
+    NSMenu* endpointMenu = [[NSMenu alloc] init];
+    const int current = Settings::getInstance().getEndpointSilenceMs();
+    for (const auto& opt : constants::EndpointOptions()) {
+        NSString* title = [NSString stringWithUTF8String:opt.second.c_str()];
+        NSMenuItem* item = [[NSMenuItem alloc] initWithTitle:title action:@selector(setEndpointSilence:) keyEquivalent:@""];
+        [item setTarget:target];
+        [item setTag:opt.first];
+        [item setState:(opt.first == current ? NSControlStateValueOn : NSControlStateValueOff)];
+        [endpointMenu addItem:item];
+    }
+    return endpointMenu;
+}
+
+static NSMenu* BuildTracingMenu(id target) {
+    NSMenu* tracingMenu = [[NSMenu alloc] init];
+    NSMenuItem* recordItem = [[NSMenuItem alloc] initWithTitle:@"Record Trace" action:@selector(toggleTracing:) keyEquivalent:@""];
+    [recordItem setTarget:target];
+    [recordItem setState:(trace::enabled() ? NSControlStateValueOn : NSControlStateValueOff)];
+    [tracingMenu addItem:recordItem];
+    NSMenuItem* saveItem = [[NSMenuItem alloc] initWithTitle:@"Save Trace to Desktop" action:@selector(saveTrace:) keyEquivalent:@""];
+    [saveItem setTarget:target];
+    [tracingMenu addItem:saveItem];
+    return tracingMenu;
+}
+
 @interface StatusBarDelegate : NSObject {
     std::function<void()> quitCallback;
     std::function<void()> settingsChangeCallback;
     std::function<void()> toggleRecordCallback;
+    std::function<void()> calibrateCallback;
+    std::function<void()> retranscribeCallback;
 }
 - (void)setQuitCallback:(std::function<void()>)callback;
 - (void)setSettingsChangeCallback:(std::function<void()>)callback;
 - (void)setToggleRecordCallback:(std::function<void()>)callback;
+- (void)setCalibrateCallback:(std::function<void()>)callback;
+- (void)setRetranscribeCallback:(std::function<void()>)callback;
 - (void)quit:(id)sender;
 - (void)toggleRecording:(id)sender;
+- (void)retranscribe:(id)sender;
 - (void)selectTinyModel:(id)sender;
 - (void)selectBaseModel:(id)sender;
 - (void)selectSmallModel:(id)sender;
@@ -152,6 +248,12 @@ static NSMenu* BuildLanguageMenu(id target) {
   - (void)setHotkey:(id)sender;
   - (void)setLanguage:(id)sender;
   - (void)setRetainSeconds:(id)sender;
+- (void)setQuantization:(id)sender;
+- (void)setLatencyTarget:(id)sender;
+- (void)calibrate:(id)sender;
+- (void)setEndpointSilence:(id)sender;
+- (void)toggleTracing:(id)sender;
+- (void)saveTrace:(id)sender;
 @end
 
 @implementation StatusBarDelegate
@@ -167,6 +269,14 @@ static NSMenu* BuildLanguageMenu(id target) {
     toggleRecordCallback = callback;
 }
 
+- (void)setCalibrateCallback:(std::function<void()>)callback {
+    calibrateCallback = callback;
+}
+
+- (void)setRetranscribeCallback:(std::function<void()>)callback {
+    retranscribeCallback = callback;
+}
+
 - (void)quit:(id)sender {
     (void)sender;
     if (quitCallback) {
@@ -181,6 +291,13 @@ static NSMenu* BuildLanguageMenu(id target) {
     }
 }
 
+- (void)retranscribe:(id)sender {
+    (void)sender;
+    if (retranscribeCallback) {
+        retranscribeCallback();
+    }
+}
+
 - (void)selectTinyModel:(id)sender {
     (void)sender;
     Settings::getInstance().setModel(Settings::MODEL_TINY);
@@ -265,6 +382,60 @@ static NSMenu* BuildLanguageMenu(id target) {
         settingsChangeCallback();
     }
 }
+
+- (void)setQuantization:(id)sender {
+    NSMenuItem* item = (NSMenuItem*)sender;
+    NSString* quant = [item representedObject];
+    Settings::getInstance().setQuantization([quant UTF8String]);
+    if (settingsChangeCallback) {
+        settingsChangeCallback();
+    }
+}
+
+- (void)setLatencyTarget:(id)sender {
+    NSMenuItem* item = (NSMenuItem*)sender;
+    int ms = (int)[item tag];
+    Settings::getInstance().setLatencyTargetMs(ms);
+    if (settingsChangeCallback) {
+        settingsChangeCallback();
+    }
+}
+
+- (void)calibrate:(id)sender {
+    (void)sender;
+    if (calibrateCallback) {
+        calibrateCallback();
+    }
+}
+
+- (void)setEndpointSilence:(id)sender {
+    NSMenuItem* item = (NSMenuItem*)sender;
+    Settings::getInstance().setEndpointSilenceMs((int)[item tag]);
+    if (settingsChangeCallback) {
+        settingsChangeCallback();
+    }
+}
+
+- (void)toggleTracing:(id)sender {
+    NSMenuItem* item = (NSMenuItem*)sender;
+    const bool on = !trace::enabled();
+    trace::setEnabled(on);
+    [item setState:(on ? NSControlStateValueOn : NSControlStateValueOff)];
+    std::cout << "[rose] tracing " << (on ? "on" : "off") << "\n";
+}
+
+- (void)saveTrace:(id)sender {
+    (void)sender;
+    NSDateFormatter* formatter = [[NSDateFormatter alloc] init];
+    [formatter setDateFormat:@"yyyyMMdd-HHmmss"];
+    NSString* name = [NSString stringWithFormat:@"rose-trace-%@.json", [formatter stringFromDate:[NSDate date]]];
+    NSString* path = [[NSHomeDirectory() stringByAppendingPathComponent:@"Desktop"] stringByAppendingPathComponent:name];
+    if (trace::dump([path UTF8String])) {
+        std::cout << "[rose] trace saved: " << [path UTF8String] << "\n";
+    } else {
+        std::cerr << "[rose] trace save failed: " << [path UTF8String] << "\n";
+    }
+}
 @end
 
 MenuBarUI::MenuBarUI() : statusItem(nullptr), delegate(nullptr) {}
@@ -286,11 +457,15 @@ MenuBarUI::~MenuBarUI() {
 
 bool MenuBarUI::initialize(std::function<void()> quitCallback,
                           std::function<void()> settingsChangeCallback,
-                          std::function<void()> toggleRecordCallback) {
+                          std::function<void()> toggleRecordCallback,
+                          std::function<void()> calibrateCallback,
+                          std::function<void()> retranscribeCallback) {
     @autoreleasepool {
         onQuit = quitCallback;
         onSettingsChange = settingsChangeCallback;
         onToggleRecord = toggleRecordCallback;
+        onCalibrate = calibrateCallback;
+        onRetranscribe = retranscribeCallback;
 
         NSStatusBar* statusBar = [NSStatusBar systemStatusBar];
         NSStatusItem* item = [statusBar statusItemWithLength:NSVariableStatusItemLength];
@@ -299,6 +474,8 @@ bool MenuBarUI::initialize(std::function<void()> quitCallback,
         [del setQuitCallback:quitCallback];
         [del setSettingsChangeCallback:settingsChangeCallback];
         [del setToggleRecordCallback:toggleRecordCallback];
+        [del setCalibrateCallback:calibrateCallback];
+        [del setRetranscribeCallback:retranscribeCallback];
         delegate = (__bridge_retained void*)del;
 
         NSStatusBarButton* button = [item button];
@@ -338,6 +515,13 @@ void MenuBarUI::updateMenu() {
         [toggleItem setTag:2];
         [menu addItem:toggleItem];
 
+        // After changing language or Best of N, decode the last dictation again.
+        NSMenuItem* retranscribeItem = [[NSMenuItem alloc] initWithTitle:@"Re-transcribe Last"
+                                                                  action:@selector(retranscribe:)
+                                                           keyEquivalent:@""];
+        [retranscribeItem setTarget:del];
+        [menu addItem:retranscribeItem];
+
         [menu addItem:[NSMenuItem separatorItem]];
 
         NSMenuItem* modelItem = [[NSMenuItem alloc] initWithTitle:@"Model" action:nil keyEquivalent:@""];
@@ -345,6 +529,16 @@ void MenuBarUI::updateMenu() {
         [modelItem setSubmenu:modelMenu];
         [menu addItem:modelItem];
 
+        NSMenuItem* quantItem = [[NSMenuItem alloc] initWithTitle:@"Quantization" action:nil keyEquivalent:@""];
+        NSMenu* quantMenu = BuildQuantizationMenu(del);
+        [quantItem setSubmenu:quantMenu];
+        [menu addItem:quantItem];
+
+        NSMenuItem* latencyItem = [[NSMenuItem alloc] initWithTitle:@"Latency Target" action:nil keyEquivalent:@""];
+        NSMenu* latencyMenu = BuildLatencyMenu(del);
+        [latencyItem setSubmenu:latencyMenu];
+        [menu addItem:latencyItem];
+
         NSMenuItem* bestOfItem = [[NSMenuItem alloc] initWithTitle:@"Best of N" action:nil keyEquivalent:@""];
         NSMenu* bestOfMenu = BuildBestOfMenu(del);
         [bestOfItem setSubmenu:bestOfMenu];
@@ -365,11 +559,21 @@ void MenuBarUI::updateMenu() {
         [languageItem setSubmenu:languageMenu];
         [menu addItem:languageItem];
 
+        NSMenuItem* endpointItem = [[NSMenuItem alloc] initWithTitle:@"Auto Stop" action:nil keyEquivalent:@""];
+        NSMenu* endpointMenu = BuildEndpointMenu(del);
+        [endpointItem setSubmenu:endpointMenu];
+        [menu addItem:endpointItem];
+
         NSMenuItem* retainItem = [[NSMenuItem alloc] initWithTitle:@"Model Retention" action:nil keyEquivalent:@""];
         NSMenu* retainMenu = BuildRetainMenu(del);
         [retainItem setSubmenu:retainMenu];
         [menu addItem:retainItem];
 
+        NSMenuItem* tracingItem = [[NSMenuItem alloc] initWithTitle:@"Tracing" action:nil keyEquivalent:@""];
+        NSMenu* tracingMenu = BuildTracingMenu(del);
+        [tracingItem setSubmenu:tracingMenu];
+        [menu addItem:tracingItem];
+
         [menu addItem:[NSMenuItem separatorItem]];
 
         NSMenuItem* quitItem = [[NSMenuItem alloc] initWithTitle:@"Quit"
@@ -384,6 +588,7 @@ void MenuBarUI::updateMenu() {
 
 void MenuBarUI::setRecordingState(bool recording) {
     @autoreleasepool {
+        this->recording = recording;
         if (!statusItem) return;
 
         NSStatusItem* item = (__bridge NSStatusItem*)statusItem;
@@ -405,6 +610,23 @@ void MenuBarUI::setRecordingState(bool recording) {
     }
 }
 
+void MenuBarUI::setBacklog(int pending) {
+    @autoreleasepool {
+        if (!statusItem || recording) return;
+
+        NSStatusItem* item = (__bridge NSStatusItem*)statusItem;
+        NSStatusBarButton* button = [item button];
+        NSMenuItem* statusMenuItem = [[item menu] itemWithTag:1];
+        if (pending > 0) {
+            [button setTitle:[NSString stringWithFormat:@"BUSY %d", pending]];
+            [statusMenuItem setTitle:[NSString stringWithFormat:@"Processing (%d pending)", pending]];
+        } else {
+            [button setTitle:@"IDLE"];
+            [statusMenuItem setTitle:@"Idle"];
+        }
+    }
+}
+
 void MenuBarUI::run() {
     @autoreleasepool {
         [[NSApplication sharedApplication] run];
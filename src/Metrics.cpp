@@ -0,0 +1,189 @@
+#include "Metrics.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace metrics {
+
+namespace {
+
+struct Entry {
+    std::string name;
+    std::string help;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Histogram> histogram;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Entry>> entries;    // registration order
+};
+
+Registry& registry() {
+    static Registry* r = new Registry();    // leaked: updated until exit
+    return *r;
+}
+
+Entry& entry(const char* name, const char* help) {
+    Registry& reg = registry();
+    for (auto& e : reg.entries) {
+        if (e->name == name) return *e;
+    }
+    reg.entries.push_back(std::make_unique<Entry>());
+    Entry& e = *reg.entries.back();
+    e.name = name;
+    e.help = help;
+    return e;
+}
+
+std::string format(double v) {
+    if (std::isnan(v)) return "NaN";
+    if (std::isinf(v)) return v > 0 ? "+Inf" : "-Inf";
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%.9g", v);
+    return buf;
+}
+
+} // namespace
+
+size_t Histogram::bucketOf(uint64_t raw) {
+    constexpr uint64_t kSub = uint64_t(1) << kSubBits;
+    if (raw < kSub) return static_cast<size_t>(raw);
+    const int msb = 63 - __builtin_clzll(raw);
+    const int shift = msb - kSubBits;
+    return (static_cast<size_t>(shift + 1) << kSubBits) + static_cast<size_t>((raw >> shift) & (kSub - 1));
+}
+
+uint64_t Histogram::bucketLow(size_t index) {
+    constexpr size_t kSub = size_t(1) << kSubBits;
+    if (index < kSub) return index;
+    const int shift = static_cast<int>(index >> kSubBits) - 1;
+    return (static_cast<uint64_t>(kSub + (index & (kSub - 1)))) << shift;
+}
+
+uint64_t Histogram::bucketHigh(size_t index) {
+    constexpr size_t kSub = size_t(1) << kSubBits;
+    if (index < kSub) return index;
+    const int shift = static_cast<int>(index >> kSubBits) - 1;
+    return bucketLow(index) + ((uint64_t(1) << shift) - 1);
+}
+
+void Histogram::record(uint64_t raw) {
+    buckets_[bucketOf(raw)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(raw, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Histogram::observe(double value) {
+    if (!(value > 0.0)) {
+        record(0);
+        return;
+    }
+    const double raw = std::round(value * unit_);
+    record(raw >= 1.8e19 ? UINT64_MAX : static_cast<uint64_t>(raw));
+}
+
+double Histogram::quantile(double q) const {
+    // Counted from the buckets, not count_, so a concurrent record() cannot
+    // push the rank past the last populated bucket.
+    uint64_t total = 0;
+    for (const auto& b : buckets_) total += b.load(std::memory_order_relaxed);
+    if (total == 0) return 0.0;
+
+    const double clamped = std::min(1.0, std::max(0.0, q));
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped * total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            const double mid = (static_cast<double>(bucketLow(i)) + static_cast<double>(bucketHigh(i))) / 2.0;
+            return mid / unit_;
+        }
+    }
+    return static_cast<double>(bucketHigh(kBuckets - 1)) / unit_;
+}
+
+Counter& counter(const char* name, const char* help) {
+    std::lock_guard<std::mutex> lk(registry().mutex);
+    Entry& e = entry(name, help);
+    if (!e.counter) e.counter = std::make_unique<Counter>();
+    return *e.counter;
+}
+
+Histogram& histogram(const char* name, const char* help, double unit) {
+    std::lock_guard<std::mutex> lk(registry().mutex);
+    Entry& e = entry(name, help);
+    if (!e.histogram) e.histogram = std::make_unique<Histogram>(unit);
+    return *e.histogram;
+}
+
+std::string render() {
+    std::ostringstream out;
+    std::lock_guard<std::mutex> lk(registry().mutex);
+    for (const auto& e : registry().entries) {
+        out << "# HELP " << e->name << " " << e->help << "\n";
+        if (e->counter) {
+            out << "# TYPE " << e->name << " counter\n"
+                << e->name << " " << e->counter->value() << "\n";
+        } else if (e->histogram) {
+            const Histogram& h = *e->histogram;
+            out << "# TYPE " << e->name << " summary\n";
+            for (const char* q : { "0.5", "0.9", "0.99" }) {
+                out << e->name << "{quantile=\"" << q << "\"} " << format(h.quantile(std::atof(q))) << "\n";
+            }
+            out << e->name << "_sum " << format(h.sum()) << "\n"
+                << e->name << "_count " << h.count() << "\n";
+        }
+    }
+    return out.str();
+}
+
+bool writeFile(const std::string& path) {
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out.is_open()) return false;
+        out << render();
+        if (!out) return false;
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+FileExporter::FileExporter(std::string path, int intervalMs)
+    : path_(std::move(path)), interval_ms_(std::max(1, intervalMs)) {
+    worker_ = std::thread([this] { run(); });
+}
+
+FileExporter::~FileExporter() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+    (void)writeFile(path_);
+}
+
+void FileExporter::run() {
+    trace::setThreadName("metrics");
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (!cv_.wait_for(lk, std::chrono::milliseconds(interval_ms_), [this] { return stopping_; })) {
+        lk.unlock();
+        (void)writeFile(path_);
+        lk.lock();
+    }
+}
+
+} // namespace metrics
@@ -0,0 +1,185 @@
+#include "ModelCatalog.h"
+#include "Constants.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <limits.h>
+#include <tuple>
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace models {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Rank of each quantization under "auto"; lower wins.
+int auto_rank(Quantization q, bool gpu) {
+    if (gpu) {
+        switch (q) {
+            case Quantization::F16:  return 0;
+            case Quantization::Q8_0: return 1;
+            case Quantization::Q5_1: return 2;
+            case Quantization::Q5_0: return 3;
+        }
+    } else {
+        switch (q) {
+            case Quantization::Q5_1: return 0;
+            case Quantization::Q5_0: return 1;
+            case Quantization::Q8_0: return 2;
+            case Quantization::F16:  return 3;
+        }
+    }
+    return 4;
+}
+
+// Keeps the historical preference large-v3 > large > large-v2 > anything else.
+int size_rank(const std::string& size) {
+    if (size == "large-v3") return 0;
+    if (size == "large") return 1;
+    if (size == "large-v2") return 2;
+    return size.find('-') == std::string::npos ? 0 : 3;
+}
+
+bool ends_with(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string executable_dir() {
+    char exePath[PATH_MAX];
+#ifdef __APPLE__
+    uint32_t sz = sizeof(exePath);
+    if (_NSGetExecutablePath(exePath, &sz) != 0) return {};
+#else
+    const ssize_t n = readlink("/proc/self/exe", exePath, sizeof(exePath) - 1);
+    if (n <= 0) return {};
+    exePath[n] = '\0';
+#endif
+    return fs::path(exePath).parent_path().string();
+}
+
+} // namespace
+
+const char* quantization_name(Quantization q) {
+    switch (q) {
+        case Quantization::F16:  return "f16";
+        case Quantization::Q8_0: return "q8_0";
+        case Quantization::Q5_1: return "q5_1";
+        case Quantization::Q5_0: return "q5_0";
+    }
+    return "f16";
+}
+
+bool parse_quantization(const std::string& name, Quantization& out) {
+    for (Quantization q : {Quantization::F16, Quantization::Q8_0, Quantization::Q5_1, Quantization::Q5_0}) {
+        if (name == quantization_name(q)) { out = q; return true; }
+    }
+    return false;
+}
+
+bool parse_model_filename(const std::string& filename, ModelFile& out) {
+    const std::string prefix = "ggml-";
+    const std::string ext = ".bin";
+    if (filename.rfind(prefix, 0) != 0 || !ends_with(filename, ext)) return false;
+    std::string stem = filename.substr(prefix.size(), filename.size() - prefix.size() - ext.size());
+
+    Quantization quant = Quantization::F16;
+    const size_t dash = stem.rfind('-');
+    if (dash != std::string::npos && parse_quantization(stem.substr(dash + 1), quant)) {
+        stem.resize(dash);
+    }
+
+    bool english_only = false;
+    if (ends_with(stem, ".en")) {
+        english_only = true;
+        stem.resize(stem.size() - 3);
+    }
+    // Skip auxiliary files such as ggml-base.en-encoder.mlmodelc or VAD models.
+    static const char* kFamilies[] = {"tiny", "base", "small", "medium", "large"};
+    const std::string family = size_family(stem);
+    if (std::none_of(std::begin(kFamilies), std::end(kFamilies),
+                     [&](const char* f) { return family == f; })) {
+        return false;
+    }
+    if (stem != family && family != "large") return false;
+
+    out.size = stem;
+    out.english_only = english_only;
+    out.quant = quant;
+    return true;
+}
+
+std::string size_family(const std::string& size) {
+    const size_t dash = size.find('-');
+    return dash == std::string::npos ? size : size.substr(0, dash);
+}
+
+std::vector<std::string> search_directories() {
+    std::vector<std::string> dirs{"models"};
+    const std::string exe = executable_dir();
+    if (!exe.empty()) {
+#ifdef __APPLE__
+        dirs.push_back((fs::path(exe).parent_path() / "Resources" / "models").string());
+#else
+        dirs.push_back((fs::path(exe) / "models").string());
+#endif
+    }
+    return dirs;
+}
+
+std::vector<ModelFile> discover(const std::string& dir) {
+    std::vector<ModelFile> found;
+    std::error_code ec;
+    if (!fs::is_directory(dir, ec)) return found;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (!entry.is_regular_file(ec)) continue;
+        ModelFile mf;
+        if (!parse_model_filename(entry.path().filename().string(), mf)) continue;
+        mf.path = fs::absolute(entry.path(), ec).string();
+        mf.bytes = entry.file_size(ec);
+        found.push_back(std::move(mf));
+    }
+    return found;
+}
+
+bool gpu_backend() {
+#ifdef __APPLE__
+    return constants::kUseGPU;
+#else
+    return false;
+#endif
+}
+
+const ModelFile* select(const std::vector<ModelFile>& found,
+                        const std::string& family,
+                        const std::string& preference,
+                        bool gpu) {
+    Quantization wanted = Quantization::F16;
+    const bool explicit_pref = preference != "auto" && parse_quantization(preference, wanted);
+
+    const ModelFile* best = nullptr;
+    auto key = [&](const ModelFile& m) {
+        // An explicit preference wins when present; otherwise fall back to auto order.
+        const int pref = explicit_pref && m.quant == wanted ? -1 : auto_rank(m.quant, gpu);
+        return std::make_tuple(pref, m.english_only ? 0 : 1, size_rank(m.size));
+    };
+    for (const auto& m : found) {
+        if (size_family(m.size) != family) continue;
+        if (!best || key(m) < key(*best)) best = &m;
+    }
+    return best;
+}
+
+std::string resolve(const std::string& family, const std::string& preference, bool gpu) {
+    for (const auto& dir : search_directories()) {
+        const auto found = discover(dir);
+        if (const auto* m = select(found, family, preference, gpu)) return m->path;
+    }
+    return {};
+}
+
+} // namespace models
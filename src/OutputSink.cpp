@@ -0,0 +1,72 @@
+#include "OutputSink.h"
+
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+
+namespace rose {
+
+StdoutSink::StdoutSink(std::ostream& out) : out_(out) {}
+
+void StdoutSink::show(int seq, const std::string& text) {
+    if (seq != seq_) {
+        if (!shown_.empty()) out_ << "\n";
+        shown_.clear();
+        seq_ = seq;
+    }
+    if (text.compare(0, shown_.size(), shown_) == 0) {
+        out_ << text.substr(shown_.size());
+    } else {
+        out_ << "\n" << text;
+    }
+    shown_ = text;
+}
+
+void StdoutSink::partial(int seq, const std::string& text) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    show(seq, text);
+    out_.flush();
+}
+
+void StdoutSink::commit(int seq, const std::string& text) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (text.empty() && (seq != seq_ || shown_.empty())) return;
+    show(seq, text);
+    out_ << "\n";
+    out_.flush();
+    seq_ = -1;
+    shown_.clear();
+}
+
+FileSink::FileSink(std::string path) : path_(std::move(path)) {}
+
+bool FileSink::write(const std::string& text) {
+    if (text == written_) return true;
+    const std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out.is_open()) return false;
+        out << text << "\n";
+        if (!out) return false;
+    }
+    if (std::rename(tmp.c_str(), path_.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    written_ = text;
+    return true;
+}
+
+void FileSink::partial(int seq, const std::string& text) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    seq_ = seq;
+    (void)write(text);
+}
+
+void FileSink::commit(int seq, const std::string& text) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!text.empty() || seq == seq_) (void)write(text);
+    seq_ = -1;
+}
+
+} // namespace rose
@@ -0,0 +1,83 @@
+#include "Pipeline.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace rose {
+
+PipelineStage::PipelineStage(const char* name, size_t capacity, sched::Role role)
+    : name_(name), capacity_(std::max<size_t>(1, capacity)), role_(role) {
+    worker_ = std::thread([this] { run(); });
+}
+
+PipelineStage::~PipelineStage() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stopping_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    worker_.join();
+}
+
+size_t PipelineStage::depth() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return queued_ + (busy_ ? 1 : 0);
+}
+
+void PipelineStage::enqueueLocked(Task&& task) {
+    tasks_.push(std::move(task));
+    ++queued_;
+    const size_t d = queued_ + (busy_ ? 1 : 0);
+    if (d > high_water_.load(std::memory_order_relaxed)) high_water_.store(d, std::memory_order_relaxed);
+}
+
+void PipelineStage::push(Task task) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (queued_ + (busy_ ? 1 : 0) >= capacity_) {
+        const auto t0 = std::chrono::steady_clock::now();
+        not_full_.wait(lk, [this] { return stopping_ || queued_ + (busy_ ? 1 : 0) < capacity_; });
+        const auto waited = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        blocked_us_.fetch_add(static_cast<uint64_t>(waited), std::memory_order_relaxed);
+    }
+    if (stopping_) return;
+    enqueueLocked(std::move(task));
+    lk.unlock();
+    not_empty_.notify_one();
+}
+
+bool PipelineStage::tryPush(Task& task) {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (stopping_ || queued_ + (busy_ ? 1 : 0) >= capacity_) return false;
+        enqueueLocked(std::move(task));
+    }
+    not_empty_.notify_one();
+    return true;
+}
+
+void PipelineStage::run() {
+    trace::setThreadName(name_);
+    (void)sched::apply(role_);
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lk(mutex_);
+            not_empty_.wait(lk, [this] { return stopping_ || queued_ > 0; });
+            if (queued_ == 0) return;
+            tasks_.steal(task);
+            --queued_;
+            busy_ = true;
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            busy_ = false;
+        }
+        not_full_.notify_all();
+    }
+}
+
+} // namespace rose
@@ -1,20 +1,36 @@
 #include "Settings.h"
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <cstdlib>
 #include <filesystem>
-#include <mach-o/dyld.h>
-#include <limits.h>
+#include <thread>
 
 #include "Constants.h"
+#include "ModelCatalog.h"
 
-Settings::Settings() : model(MODEL_TINY), bestOfN(constants::kBestOfNDefault), hotkey(constants::kDefaultHotkey), deviceId(-1), language("en"), retainSeconds(constants::kRetainSecondsDefault) {
+Settings::Values::Values() : model(MODEL_TINY), bestOfN(constants::kBestOfNDefault), hotkey(constants::kDefaultHotkey), deviceId(-1), language("en"), retainSeconds(constants::kRetainSecondsDefault), latencyTargetMs(constants::kLatencyTargetOff), endpointSilenceMs(constants::kEndpointOff) {
+    for (auto& q : quantization) q = constants::kDefaultQuantization;
+}
+
+Settings::Settings() {
     const char* home = std::getenv("HOME");
     if (home) {
         configPath = std::string(home) + "/.rose_config";
     } else {
         configPath = ".rose_config";
     }
+    publish(std::make_unique<Values>());
+}
+
+Settings::~Settings() {
+    {
+        std::lock_guard<std::mutex> lk(saveMutex);
+        saveStopping = true;
+    }
+    saveCv.notify_all();
+    if (saveThread.joinable()) saveThread.join();
 }
 
 Settings& Settings::getInstance() {
@@ -22,10 +38,28 @@ Settings& Settings::getInstance() {
     return instance;
 }
 
+void Settings::publish(std::unique_ptr<Values> next) {
+    std::atomic_store_explicit(&current, std::shared_ptr<const Values>(std::move(next)),
+                               std::memory_order_release);
+}
+
+std::string Settings::getConfigPath() const {
+    std::lock_guard<std::mutex> lk(fileMutex);
+    return configPath;
+}
+
+void Settings::setConfigPath(const std::string& path) {
+    std::lock_guard<std::mutex> lk(fileMutex);
+    configPath = path;
+}
+
 void Settings::load() {
-    std::ifstream file(configPath);
+    std::ifstream file(getConfigPath());
     if (!file.is_open()) return;
 
+    std::lock_guard<std::mutex> lk(writeMutex);
+    auto next = std::make_unique<Values>(*snapshot());
+    Values& v = *next;
     std::string line;
     while (std::getline(file, line)) {
         size_t pos = line.find('=');
@@ -37,146 +71,252 @@ void Settings::load() {
         if (key == "model") {
             int m = std::stoi(value);
             if (m >= MODEL_TINY && m <= MODEL_LARGE) {
-                model = static_cast<Model>(m);
+                v.model = static_cast<Model>(m);
             }
         } else if (key == "bestOfN") {
             int n = std::stoi(value);
             if (n >= constants::kBestOfNMin && n <= constants::kBestOfNMax) {
-                bestOfN = n;
+                v.bestOfN = n;
             }
         } else if (key == "hotkey") {
-            hotkey = value;
+            v.hotkey = value;
         } else if (key == "deviceId") {
-            deviceId = std::stoi(value);
+            v.deviceId = std::stoi(value);
         } else if (key == "language") {
-            if (!value.empty()) language = value;
+            if (!value.empty()) v.language = value;
         } else if (key == "retainSeconds") {
             int s = std::stoi(value);
             if (s >= constants::kRetainSecondsMin && s <= constants::kRetainSecondsMax) {
-                retainSeconds = s;
+                v.retainSeconds = s;
+            }
+        } else if (key == "latencyTargetMs") {
+            int ms = std::stoi(value);
+            if (ms >= 0) v.latencyTargetMs = ms;
+        } else if (key == "endpointSilenceMs") {
+            int ms = std::stoi(value);
+            if (ms >= constants::kEndpointOff) v.endpointSilenceMs = ms;
+        } else if (key == "calibration") {
+            calibration::ModelProfile p;
+            if (calibration::parse(value, p)) v.calibrationProfiles.push_back(p);
+        } else if (key.rfind("quant.", 0) == 0) {
+            const std::string family = key.substr(6);
+            for (int m = MODEL_TINY; m <= MODEL_LARGE; ++m) {
+                if (family != modelFamily(static_cast<Model>(m))) continue;
+                for (const auto& kv : constants::QuantizationOptions()) {
+                    if (kv.first == value) v.quantization[m] = value;
+                }
             }
         }
     }
+    publish(std::move(next));
 }
 
-void Settings::save() {
-    std::ofstream file(configPath);
-    if (!file.is_open()) return;
+bool Settings::write(const Values& v) const {
+    // Through a temporary and rename, so a crash mid-write keeps the old file.
+    // An explicit save() may overlap the debounced one; they take turns.
+    std::lock_guard<std::mutex> lk(fileMutex);
+    const std::string tmp = configPath + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        file << "model=" << static_cast<int>(v.model) << "\n";
+        file << "bestOfN=" << v.bestOfN << "\n";
+        file << "hotkey=" << v.hotkey << "\n";
+        file << "deviceId=" << v.deviceId << "\n";
+        file << "language=" << v.language << "\n";
+        file << "retainSeconds=" << v.retainSeconds << "\n";
+        for (int m = MODEL_TINY; m <= MODEL_LARGE; ++m) {
+            file << "quant." << modelFamily(static_cast<Model>(m)) << "=" << v.quantization[m] << "\n";
+        }
+        file << "latencyTargetMs=" << v.latencyTargetMs << "\n";
+        file << "endpointSilenceMs=" << v.endpointSilenceMs << "\n";
+        for (const auto& p : v.calibrationProfiles) {
+            file << "calibration=" << calibration::serialize(p) << "\n";
+        }
+        if (!file) return false;
+    }
+    if (std::rename(tmp.c_str(), configPath.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
 
-    file << "model=" << static_cast<int>(model) << "\n";
-    file << "bestOfN=" << bestOfN << "\n";
-    file << "hotkey=" << hotkey << "\n";
-    file << "deviceId=" << deviceId << "\n";
-    file << "language=" << language << "\n";
-    file << "retainSeconds=" << retainSeconds << "\n";
+void Settings::save() {
+    {
+        std::lock_guard<std::mutex> lk(saveMutex);
+        saveDirty = false;
+    }
+    if (!write(*snapshot())) std::cerr << "[rose] cannot save " << getConfigPath() << "\n";
 }
 
-void Settings::setModel(Model m) {
-    if (model != m) {
-        model = m;
-        save();
-        notifyChange();
+void Settings::scheduleSave() {
+    {
+        std::lock_guard<std::mutex> lk(saveMutex);
+        saveDirty = true;
+        saveDue = std::chrono::steady_clock::now() + std::chrono::milliseconds(constants::kSettingsSaveDebounceMs);
+        if (!saveThread.joinable()) saveThread = std::thread([this] { saveLoop(); });
     }
+    saveCv.notify_all();
 }
 
-void Settings::setBestOfN(int n) {
-    if (n >= constants::kBestOfNMin && n <= constants::kBestOfNMax && bestOfN != n) {
-        bestOfN = n;
-        save();
-        notifyChange();
+void Settings::saveLoop() {
+    std::unique_lock<std::mutex> lk(saveMutex);
+    while (true) {
+        saveCv.wait(lk, [this] { return saveDirty || saveStopping; });
+        // Each change pushes the write back, so a burst of clicks saves once.
+        while (saveDirty && !saveStopping && std::chrono::steady_clock::now() < saveDue) {
+            saveCv.wait_until(lk, saveDue);
+        }
+        if (saveDirty) {
+            saveDirty = false;
+            lk.unlock();
+            if (!write(*snapshot())) std::cerr << "[rose] cannot save " << getConfigPath() << "\n";
+            lk.lock();
+        }
+        if (saveStopping) return;
     }
 }
 
-void Settings::setHotkey(const std::string& key) {
-    if (hotkey == key) return;
-    bool allowed = false;
-    for (const auto& kv : constants::HotkeyOptions()) {
-        if (kv.first == key) { allowed = true; break; }
+void Settings::update(const std::function<bool(Values&)>& change) {
+    {
+        std::lock_guard<std::mutex> lk(writeMutex);
+        auto next = std::make_unique<Values>(*snapshot());
+        if (!change(*next)) return;
+        publish(std::move(next));
     }
-    if (!allowed) return;
-    hotkey = key;
-    save();
+    scheduleSave();
     notifyChange();
 }
 
+void Settings::setModel(Model m) {
+    update([m](Values& v) {
+        if (v.model == m) return false;
+        v.model = m;
+        return true;
+    });
+}
+
+void Settings::setBestOfN(int n) {
+    update([n](Values& v) {
+        if (n < constants::kBestOfNMin || n > constants::kBestOfNMax || v.bestOfN == n) return false;
+        v.bestOfN = n;
+        return true;
+    });
+}
+
+void Settings::setHotkey(const std::string& key) {
+    update([&key](Values& v) {
+        if (v.hotkey == key) return false;
+        bool allowed = false;
+        for (const auto& kv : constants::HotkeyOptions()) {
+            if (kv.first == key) { allowed = true; break; }
+        }
+        if (!allowed) return false;
+        v.hotkey = key;
+        return true;
+    });
+}
+
 void Settings::setDeviceId(int id) {
-    if (deviceId != id) {
-        deviceId = id;
-        save();
-        notifyChange();
-    }
+    update([id](Values& v) {
+        if (v.deviceId == id) return false;
+        v.deviceId = id;
+        return true;
+    });
 }
 
 void Settings::setLanguage(const std::string& lang) {
-    if (lang.empty() || language == lang) return;
-    language = lang;
-    save();
-    notifyChange();
+    update([&lang](Values& v) {
+        if (lang.empty() || v.language == lang) return false;
+        v.language = lang;
+        return true;
+    });
 }
 
+void Settings::setLatencyTargetMs(int ms) {
+    update([ms](Values& v) {
+        if (ms < 0 || v.latencyTargetMs == ms) return false;
+        v.latencyTargetMs = ms;
+        return true;
+    });
+}
 
-std::string Settings::getModelPath() const {
-    namespace fs = std::filesystem;
+void Settings::setCalibration(std::vector<calibration::ModelProfile> profiles) {
+    update([&profiles](Values& v) {
+        v.calibrationProfiles = std::move(profiles);
+        return true;
+    });
+}
 
-    auto candidates_for_model = [this]() -> std::vector<std::string> {
-        switch (model) {
-            case MODEL_TINY:   return {"ggml-tiny.en.bin",   "ggml-tiny.bin"};
-            case MODEL_BASE:   return {"ggml-base.en.bin",   "ggml-base.bin"};
-            case MODEL_SMALL:  return {"ggml-small.en.bin",  "ggml-small.bin"};
-            case MODEL_MEDIUM: return {"ggml-medium.en.bin", "ggml-medium.bin"};
-            case MODEL_LARGE:  return {"ggml-large-v3.bin",  "ggml-large.bin", "ggml-large-v2.bin"};
-            default:           return {"ggml-tiny.en.bin",   "ggml-tiny.bin"};
-        }
-    }();
-
-    auto prefix_for_model = [this]() -> std::string {
-        switch (model) {
-            case MODEL_TINY:   return "ggml-tiny";
-            case MODEL_BASE:   return "ggml-base";
-            case MODEL_SMALL:  return "ggml-small";
-            case MODEL_MEDIUM: return "ggml-medium";
-            case MODEL_LARGE:  return "ggml-large";
-            default:           return "ggml-tiny";
-        }
-    }();
+bool Settings::Values::calibratedChoice(calibration::Choice& out) const {
+    if (latencyTargetMs <= constants::kLatencyTargetOff || calibrationProfiles.empty()) return false;
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    return calibration::choose(calibrationProfiles, latencyTargetMs, bestOfN, hw, out);
+}
 
-    auto find_in_dir = [&](const fs::path& dir) -> std::string {
-        
-        for (const auto& name : candidates_for_model) {
-            fs::path p = dir / name;
-            if (fs::exists(p)) return fs::absolute(p).string();
-        }
-        
-        if (fs::exists(dir) && fs::is_directory(dir)) {
-            for (const auto& entry : fs::directory_iterator(dir)) {
-                if (!entry.is_regular_file()) continue;
-                auto fname = entry.path().filename().string();
-                if (fname.rfind(prefix_for_model, 0) == 0 && entry.path().extension() == ".bin") {
-                    return fs::absolute(entry.path()).string();
-                }
-            }
+Settings::Model Settings::Values::effectiveModel() const {
+    calibration::Choice choice;
+    if (!calibratedChoice(choice)) return model;
+    for (int m = MODEL_TINY; m <= MODEL_LARGE; ++m) {
+        if (choice.family == modelFamily(static_cast<Model>(m))) return static_cast<Model>(m);
+    }
+    return model;
+}
+
+int Settings::Values::decodeThreads() const {
+    calibration::Choice choice;
+    if (!calibratedChoice(choice)) return constants::kWhisperThreads;
+    return choice.threads;
+}
+
+void Settings::setQuantization(const std::string& quant) {
+    update([&quant](Values& v) {
+        const Model m = v.effectiveModel();
+        if (v.quantization[m] == quant) return false;
+        bool allowed = false;
+        for (const auto& kv : constants::QuantizationOptions()) {
+            if (kv.first == quant) { allowed = true; break; }
         }
-        return {};
-    };
-
-    
-    if (auto p = find_in_dir(fs::path("models")); !p.empty()) return p;
-
-    
-    char exePath[PATH_MAX];
-    uint32_t sz = sizeof(exePath);
-    if (_NSGetExecutablePath(exePath, &sz) == 0) {
-        fs::path exec = fs::path(exePath);
-        fs::path resModelsDir = exec.parent_path().parent_path() / "Resources" / "models";
-        if (auto p = find_in_dir(resModelsDir); !p.empty()) return p;
+        if (!allowed) return false;
+        v.quantization[m] = quant;
+        return true;
+    });
+}
+
+const char* Settings::modelFamily(Model m) {
+    switch (m) {
+        case MODEL_TINY:   return "tiny";
+        case MODEL_BASE:   return "base";
+        case MODEL_SMALL:  return "small";
+        case MODEL_MEDIUM: return "medium";
+        case MODEL_LARGE:  return "large";
+        default:           return "tiny";
+    }
+}
+
+
+std::string Settings::getModelPath() const {
+    namespace fs = std::filesystem;
+
+    // Search directories in priority order; within a directory pick the variant
+    // (quantization, .en, large revision) that best fits the preference and backend.
+    const auto snap = snapshot();
+    const Values& v = *snap;
+    const Model effective = v.effectiveModel();
+    const std::string family = modelFamily(effective);
+    if (auto path = models::resolve(family, v.quantization[effective], models::gpu_backend()); !path.empty()) {
+        return path;
     }
 
-    
-    return (fs::path("models") / candidates_for_model.front()).string();
+    const std::string fallback = effective == MODEL_LARGE ? "ggml-large-v3.bin"
+                                                      : std::string("ggml-") + family + ".en.bin";
+    return (fs::path("models") / fallback).string();
 }
 
 std::string Settings::getModelName() const {
-    switch (model) {
+    switch (getEffectiveModel()) {
         case MODEL_TINY: return "Tiny (Fast)";
         case MODEL_BASE: return "Base (Balanced)";
         case MODEL_SMALL: return "Small (Quality)";
@@ -192,11 +332,19 @@ void Settings::notifyChange() {
     }
 }
 
+void Settings::setEndpointSilenceMs(int ms) {
+    update([ms](Values& v) {
+        if (ms < constants::kEndpointOff || v.endpointSilenceMs == ms) return false;
+        v.endpointSilenceMs = ms;
+        return true;
+    });
+}
+
 void Settings::setModelRetainSeconds(int seconds) {
-    if (seconds < constants::kRetainSecondsMin || seconds > constants::kRetainSecondsMax) return;
-    if (retainSeconds != seconds) {
-        retainSeconds = seconds;
-        save();
-        notifyChange();
-    }
+    update([seconds](Values& v) {
+        if (seconds < constants::kRetainSecondsMin || seconds > constants::kRetainSecondsMax) return false;
+        if (v.retainSeconds == seconds) return false;
+        v.retainSeconds = seconds;
+        return true;
+    });
 }
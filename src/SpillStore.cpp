@@ -0,0 +1,109 @@
+#include "SpillStore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace audio {
+
+namespace {
+
+bool fail(std::string* error, const std::string& message) {
+    if (error) *error = message;
+    return false;
+}
+
+} // namespace
+
+SpillStore::SpillStore(std::string dir, size_t max_samples)
+    : dir_(std::move(dir)), max_samples_(max_samples) {}
+
+SpillStore::~SpillStore() {
+    if (map_) ::munmap(const_cast<int16_t*>(map_), map_bytes_);
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool SpillStore::open(std::string* error) {
+    std::string path = dir_ + "/rose-capture-XXXXXX";
+    fd_ = ::mkstemp(path.data());
+    if (fd_ < 0) return fail(error, "cannot create capture file in " + dir_ + ": " + std::strerror(errno));
+    ::unlink(path.c_str());
+    return true;
+}
+
+bool SpillStore::append(const int16_t* samples, size_t n) {
+    if (fd_ < 0 || map_ || size_ + n > max_samples_) return false;
+    const char* p = reinterpret_cast<const char*>(samples);
+    size_t left = n * sizeof(int16_t);
+    off_t at = static_cast<off_t>(size_ * sizeof(int16_t));
+    while (left > 0) {
+        const ssize_t w = ::pwrite(fd_, p, left, at);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) {
+            // Keep the file a whole number of appends.
+            (void)::ftruncate(fd_, static_cast<off_t>(size_ * sizeof(int16_t)));
+            return false;
+        }
+        p += w;
+        at += w;
+        left -= static_cast<size_t>(w);
+    }
+    size_ += n;
+    return true;
+}
+
+void SpillStore::truncate(size_t n) {
+    if (map_ || n >= size_) return;
+    size_ = n;
+    (void)::ftruncate(fd_, static_cast<off_t>(size_ * sizeof(int16_t)));
+}
+
+bool SpillStore::seal() {
+    if (map_) return true;
+    if (fd_ < 0 || size_ == 0) return false;
+    map_bytes_ = size_ * sizeof(int16_t);
+    void* p = ::mmap(nullptr, map_bytes_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        map_bytes_ = 0;
+        return false;
+    }
+    ::madvise(p, map_bytes_, MADV_SEQUENTIAL);
+    map_ = static_cast<const int16_t*>(p);
+    return true;
+}
+
+void SpillStore::release(size_t offset, size_t n) const {
+    if (!map_) return;
+    // Whole pages inside the range only; its neighbours may still be read.
+    const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t from = (offset * sizeof(int16_t) + page - 1) / page * page;
+    const size_t to = std::min(map_bytes_, (offset + n) * sizeof(int16_t)) / page * page;
+    if (to > from) {
+        ::madvise(const_cast<char*>(reinterpret_cast<const char*>(map_)) + from, to - from, MADV_DONTNEED);
+    }
+}
+
+size_t chunk_end(const SpillStore& store, size_t begin, size_t max_len, size_t search, int sample_rate) {
+    const size_t size = store.size();
+    if (size - begin <= max_len) return size;
+    const size_t end = begin + max_len;
+    const size_t frame = static_cast<size_t>(std::max(1, sample_rate / 50));
+    search = std::min(search, max_len / 2);
+    const int16_t* pcm = store.data();
+    size_t best = end;
+    double best_energy = -1.0;
+    for (size_t at = end - search; at + frame <= end; at += frame) {
+        double e = 0.0;
+        for (size_t i = at; i < at + frame; ++i) e += static_cast<double>(pcm[i]) * pcm[i];
+        if (best_energy < 0.0 || e < best_energy) {
+            best_energy = e;
+            best = at + frame / 2;
+        }
+    }
+    return best;
+}
+
+} // namespace audio
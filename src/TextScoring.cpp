@@ -1,6 +1,8 @@
 ﻿#include "TextScoring.h"
 
 #include <algorithm>
+#include <cctype>
+#include <string>
 
 namespace textscore {
 
@@ -14,9 +16,76 @@ const TranscriptionResult& select_best(const std::vector<TranscriptionResult>& r
         return kEmpty;
     }
     return *std::max_element(results.begin(), results.end(), [](const TranscriptionResult& a, const TranscriptionResult& b) {
+        if (a.degenerate != b.degenerate) return a.degenerate;
+        if (a.truncated != b.truncated) return a.truncated;
         return a.score < b.score;
     });
 }
 
+namespace {
+
+bool word_char(unsigned char c) {
+    return std::isalnum(c) || c == '\'' || c >= 0x80;
+}
+
+std::vector<std::string> normalized_words(const std::string& text, std::vector<size_t>* starts = nullptr) {
+    std::vector<std::string> words;
+    for (size_t i = 0; i < text.size();) {
+        if (!word_char(static_cast<unsigned char>(text[i]))) {
+            ++i;
+            continue;
+        }
+        if (starts) starts->push_back(i);
+        std::string w;
+        for (; i < text.size() && word_char(static_cast<unsigned char>(text[i])); ++i) {
+            w += static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+        }
+        words.push_back(std::move(w));
+    }
+    return words;
+}
+
+} // namespace
+
+double word_error_rate(const std::string& reference, const std::string& hypothesis) {
+    const auto ref = normalized_words(reference);
+    const auto hyp = normalized_words(hypothesis);
+    if (ref.empty()) return hyp.empty() ? 0.0 : 1.0;
+
+    // Levenshtein distance over words, one row at a time.
+    std::vector<size_t> prev(hyp.size() + 1), cur(hyp.size() + 1);
+    for (size_t j = 0; j <= hyp.size(); ++j) prev[j] = j;
+    for (size_t i = 1; i <= ref.size(); ++i) {
+        cur[0] = i;
+        for (size_t j = 1; j <= hyp.size(); ++j) {
+            const size_t sub = prev[j - 1] + (ref[i - 1] == hyp[j - 1] ? 0 : 1);
+            cur[j] = std::min({ sub, prev[j] + 1, cur[j - 1] + 1 });
+        }
+        std::swap(prev, cur);
+    }
+    return static_cast<double>(prev[hyp.size()]) / ref.size();
+}
+
+size_t repetition_start(const std::string& text, int max_n, int min_repeats, int min_words) {
+    std::vector<size_t> starts;
+    const auto words = normalized_words(text, &starts);
+    const size_t total = words.size();
+    size_t best = std::string::npos;
+    for (size_t n = 1; n <= static_cast<size_t>(std::max(0, max_n)) && 2 * n <= total; ++n) {
+        // Count copies of the last n words running back from the end.
+        size_t repeats = 1;
+        while ((repeats + 1) * n <= total &&
+               std::equal(words.end() - n, words.end(), words.end() - (repeats + 1) * n)) {
+            ++repeats;
+        }
+        if (repeats < static_cast<size_t>(std::max(2, min_repeats)) ||
+            repeats * n < static_cast<size_t>(min_words)) {
+            continue;
+        }
+        best = std::min(best, starts[total - (repeats - 1) * n]);
+    }
+    return best;
+}
+
 } // namespace textscore
 
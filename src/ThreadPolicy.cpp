@@ -0,0 +1,179 @@
+#include "ThreadPolicy.h"
+#include "Constants.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <pthread.h>
+#if defined(__APPLE__)
+#include <pthread/qos.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace sched {
+
+namespace {
+
+std::atomic<bool> g_reserve_audio { false };
+
+#if defined(__linux__)
+std::string readFile(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+// Intel hybrid parts list their P-cores directly; otherwise compare the
+// per-core maximum frequencies (big.LITTLE ARM).
+std::vector<int> performanceCpus(int n) {
+    std::vector<int> listed = parseCpuList(readFile("/sys/devices/cpu_core/cpus"));
+    if (!listed.empty()) return listed;
+    std::vector<long> khz(static_cast<size_t>(n), 0);
+    for (int c = 0; c < n; ++c) {
+        khz[static_cast<size_t>(c)] = std::atol(readFile(
+            "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/cpufreq/cpuinfo_max_freq").c_str());
+    }
+    return fastestCpus(khz);
+}
+
+bool pinTo(const std::vector<int>& cpus) {
+    if (cpus.empty()) return true;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) CPU_SET(c, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+}
+
+struct Layout {
+    int audio = -1;
+    std::vector<int> decode;
+};
+
+const Layout& layout() {
+    static const Layout l = [] {
+        Layout out;
+        const int n = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        const std::vector<int> fast = performanceCpus(n);
+        // Audio gets a core decode never uses: a slow core if there is one,
+        // else CPU 0, and only when that still leaves decode most of the machine.
+        if (g_reserve_audio.load() && n > 2) {
+            out.audio = 0;
+            for (int c = 0; c < n; ++c) {
+                if (!std::binary_search(fast.begin(), fast.end(), c)) { out.audio = c; break; }
+            }
+        }
+        const char* env = std::getenv(constants::kDecodeCpusEnvVar);
+        out.decode = env && env[0] ? parseCpuList(env) : fast;
+        out.decode.erase(std::remove_if(out.decode.begin(), out.decode.end(),
+                                        [&](int c) { return c == out.audio || c >= n; }),
+                         out.decode.end());
+        // Only worth restricting when it excludes something.
+        if (static_cast<int>(out.decode.size()) == n) out.decode.clear();
+        if (out.decode.empty() && out.audio >= 0) {
+            for (int c = 0; c < n; ++c) if (c != out.audio) out.decode.push_back(c);
+        }
+        return out;
+    }();
+    return l;
+}
+#endif
+
+} // namespace
+
+void reserveAudioCpu() { g_reserve_audio.store(true); }
+
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> out;
+    std::stringstream in(list);
+    for (std::string item; std::getline(in, item, ',');) {
+        if (item.empty()) continue;
+        const size_t dash = item.find('-');
+        char* end = nullptr;
+        const long lo = std::strtol(item.c_str(), &end, 10);
+        if (end == item.c_str() || lo < 0) return {};
+        long hi = lo;
+        if (dash != std::string::npos) {
+            const char* from = item.c_str() + dash + 1;
+            hi = std::strtol(from, &end, 10);
+            if (end == from || hi < lo) return {};
+        }
+        if (*end != '\0' && *end != '\n') return {};
+        for (long c = lo; c <= hi; ++c) out.push_back(static_cast<int>(c));
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+std::vector<int> fastestCpus(const std::vector<long>& max_khz) {
+    std::vector<int> out;
+    const long top = max_khz.empty() ? 0 : *std::max_element(max_khz.begin(), max_khz.end());
+    const bool known = std::none_of(max_khz.begin(), max_khz.end(), [](long k) { return k <= 0; });
+    for (size_t c = 0; c < max_khz.size(); ++c) {
+        if (!known || max_khz[c] == top) out.push_back(static_cast<int>(c));
+    }
+    return out;
+}
+
+#if defined(__linux__)
+
+const std::vector<int>& decodeCpus() { return layout().decode; }
+int audioCpu() { return layout().audio; }
+
+bool apply(Role role) {
+    switch (role) {
+        case Role::Audio: {
+            sched_param param{};
+            param.sched_priority = constants::kAudioRealtimePriority;
+            bool ok = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+            if (!ok) {
+                // Unprivileged: a raised nice value is the most left to ask for.
+                ok = setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), constants::kAudioNice) == 0;
+            }
+            const int cpu = audioCpu();
+            return (cpu < 0 || pinTo({ cpu })) && ok;
+        }
+        case Role::Decode:
+            return pinTo(decodeCpus());
+        case Role::Pipeline:
+        case Role::Default:
+            return true;
+    }
+    return true;
+}
+
+#else
+
+const std::vector<int>& decodeCpus() {
+    static const std::vector<int> none;
+    return none;
+}
+int audioCpu() { return -1; }
+
+bool apply(Role role) {
+#if defined(__APPLE__)
+    switch (role) {
+        case Role::Decode:
+        case Role::Pipeline:
+            return pthread_set_qos_class_self_np(QOS_CLASS_USER_INITIATED, 0) == 0;
+        case Role::Audio:       // already real-time under CoreAudio
+        case Role::Default:
+            return true;
+    }
+#endif
+    (void)role;
+    return true;
+}
+
+#endif
+
+} // namespace sched
@@ -0,0 +1,139 @@
+#include "Trace.h"
+#include "Constants.h"
+#include "Json.h"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+
+namespace trace {
+
+namespace {
+
+struct Event {
+    const char* name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    int64_t arg;
+};
+
+// Single writer (the owning thread); dump() reads it concurrently.
+struct Ring {
+    explicit Ring(uint32_t id) : tid(id), events(constants::kTraceRingEvents) {}
+
+    const uint32_t tid;
+    std::string name;   // guarded by registry().mutex
+    std::vector<Event> events;
+    std::atomic<uint64_t> written { 0 };
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Ring>> rings;   // kept after their threads exit
+    uint32_t next_tid = 1;
+};
+
+Registry& registry() {
+    static Registry* r = new Registry();    // leaked: threads may trace during exit
+    return *r;
+}
+
+const std::chrono::steady_clock::time_point kEpoch = std::chrono::steady_clock::now();
+
+thread_local Ring* tl_ring = nullptr;
+thread_local const char* tl_name = nullptr;
+
+Ring& thread_ring() {
+    if (!tl_ring) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lk(reg.mutex);
+        auto ring = std::make_shared<Ring>(reg.next_tid++);
+        if (tl_name) ring->name = tl_name;
+        reg.rings.push_back(ring);
+        tl_ring = ring.get();
+    }
+    return *tl_ring;
+}
+
+} // namespace
+
+namespace detail {
+
+std::atomic<bool> g_enabled { false };
+
+uint64_t now_ns() {
+    // +1 keeps 0 free as the "not recording" marker in Span.
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - kEpoch).count()) + 1;
+}
+
+void record(const char* name, uint64_t start_ns, uint64_t end_ns, int64_t arg) {
+    Ring& ring = thread_ring();
+    const uint64_t n = ring.written.load(std::memory_order_relaxed);
+    ring.events[n % ring.events.size()] = Event{ name, start_ns, end_ns, arg };
+    ring.written.store(n + 1, std::memory_order_release);
+}
+
+} // namespace detail
+
+void setEnabled(bool on) {
+    detail::g_enabled.store(on, std::memory_order_relaxed);
+}
+
+void setThreadName(const char* name) {
+    tl_name = name;
+    if (tl_ring) {
+        std::lock_guard<std::mutex> lk(registry().mutex);
+        tl_ring->name = name;
+    }
+}
+
+bool dump(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lk(registry().mutex);
+        rings = registry().rings;
+    }
+    const int pid = static_cast<int>(::getpid());
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto sep = [&]() -> std::ofstream& {
+        out << (first ? "" : ",\n");
+        first = false;
+        return out;
+    };
+    for (const auto& ring : rings) {
+        std::string name;
+        {
+            std::lock_guard<std::mutex> lk(registry().mutex);
+            name = ring->name;
+        }
+        if (!name.empty()) {
+            sep() << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << ring->tid
+                  << ",\"args\":{\"name\":" << json::quote(name) << "}}";
+        }
+
+        const uint64_t written = ring->written.load(std::memory_order_acquire);
+        const uint64_t cap = ring->events.size();
+        for (uint64_t i = written > cap ? written - cap : 0; i < written; ++i) {
+            const Event e = ring->events[i % cap];
+            sep() << "{\"ph\":\"X\",\"cat\":\"rose\",\"name\":" << json::quote(e.name)
+                  << ",\"pid\":" << pid << ",\"tid\":" << ring->tid
+                  << ",\"ts\":" << json::number(e.start_ns / 1000.0)
+                  << ",\"dur\":" << json::number((e.end_ns - e.start_ns) / 1000.0);
+            if (e.arg != kNoArg) out << ",\"args\":{\"v\":" << e.arg << "}";
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace trace
@@ -0,0 +1,339 @@
+#include "TranscriptCache.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kFileMagic[8] = { 'R', 'O', 'S', 'E', 'C', 'A', 'C', 'H' };
+constexpr uint32_t kFileVersion = 1;
+constexpr size_t kFileHeaderSize = 16;
+
+// Record: u32 size (padded to 8), u32 checksum of the bytes after it,
+// u64 key hi, u64 key lo, f32 avg_logprob, f32 no_speech_prob, f32 score,
+// u32 text length, text bytes, zero padding.
+constexpr size_t kRecordHeaderSize = 40;
+
+uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+uint64_t mix(uint64_t h, uint64_t v) {
+    h ^= v * 0x9e3779b97f4a7c15ull;
+    return rotl(h, 31) * 0xbf58476d1ce4e5b9ull;
+}
+
+uint64_t finalize(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    return h ^ (h >> 33);
+}
+
+uint32_t checksum(const unsigned char* p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+template <class T>
+T load(const unsigned char* p) {
+    T v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+template <class T>
+void put(std::vector<unsigned char>& out, size_t at, T v) {
+    std::memcpy(out.data() + at, &v, sizeof v);
+}
+
+bool fail(std::string* error, const std::string& msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+size_t file_size(int fd) {
+    struct stat st;
+    return ::fstat(fd, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+}
+
+bool write_all(int fd, const void* data, size_t n) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    while (n > 0) {
+        const ssize_t w = ::write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+} // namespace
+
+TranscriptCache::Key TranscriptCache::makeKey(const std::vector<float>& pcm,
+                                              const std::string& model,
+                                              const std::string& language,
+                                              int bestOfN) {
+    // Two independently seeded lanes over the raw samples, 8 bytes at a time.
+    uint64_t a = 0x243f6a8885a308d3ull;
+    uint64_t b = 0x13198a2e03707344ull;
+    const auto* bytes = reinterpret_cast<const unsigned char*>(pcm.data());
+    const size_t n = pcm.size() * sizeof(float);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint64_t v = load<uint64_t>(bytes + i);
+        a = mix(a, v);
+        b = mix(b, v ^ 0xa4093822299f31d0ull);
+    }
+    uint64_t tail = 0;
+    if (i < n) std::memcpy(&tail, bytes + i, n - i);
+    a = mix(a, tail);
+    b = mix(b, tail);
+
+    auto absorb = [&](const std::string& s) {
+        for (unsigned char c : s) {
+            a = mix(a, c);
+            b = mix(b, c + 0x100u);
+        }
+        a = mix(a, s.size());
+        b = mix(b, s.size() + 1);
+    };
+    absorb(model);
+    absorb(language);
+    a = mix(a, static_cast<uint64_t>(bestOfN));
+    b = mix(b, static_cast<uint64_t>(n));
+    return Key{ finalize(a), finalize(b ^ a) };
+}
+
+TranscriptCache::TranscriptCache(std::string path, size_t maxBytes)
+    : path_(std::move(path)), maxBytes_(std::max<size_t>(maxBytes, 4096)) {}
+
+TranscriptCache::~TranscriptCache() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    unmapLocked();
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool TranscriptCache::open(std::string* error) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return reopenLocked(error);
+}
+
+void TranscriptCache::unmapLocked() {
+    if (map_) ::munmap(const_cast<unsigned char*>(map_), mapSize_);
+    map_ = nullptr;
+    mapSize_ = 0;
+}
+
+bool TranscriptCache::remapLocked(size_t size) {
+    if (map_ && size == mapSize_) return true;
+    unmapLocked();
+    if (size == 0) return true;
+    void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) return false;
+    map_ = static_cast<const unsigned char*>(p);
+    mapSize_ = size;
+    return true;
+}
+
+bool TranscriptCache::reopenLocked(std::string* error) {
+    unmapLocked();
+    if (fd_ >= 0) ::close(fd_);
+    index_.clear();
+    indexedEnd_ = 0;
+
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) return fail(error, "cannot open " + path_ + ": " + std::strerror(errno));
+    struct stat st;
+    ::fstat(fd_, &st);
+    inode_ = static_cast<uint64_t>(st.st_ino);
+
+    ::flock(fd_, LOCK_EX);
+    size_t size = file_size(fd_);
+    bool ok = true;
+    if (size == 0) {
+        unsigned char header[kFileHeaderSize] = {};
+        std::memcpy(header, kFileMagic, sizeof kFileMagic);
+        std::memcpy(header + 8, &kFileVersion, sizeof kFileVersion);
+        ok = write_all(fd_, header, sizeof header);
+        size = kFileHeaderSize;
+    }
+    if (ok && remapLocked(size)) {
+        if (size < kFileHeaderSize || std::memcmp(map_, kFileMagic, sizeof kFileMagic) != 0 ||
+            load<uint32_t>(map_ + 8) != kFileVersion) {
+            ok = fail(error, path_ + " is not a rose transcript cache");
+        } else {
+            const size_t end = indexLocked(kFileHeaderSize);
+            if (end < size) {
+                // Torn append from a crashed writer; later appends must follow valid records.
+                ok = ::ftruncate(fd_, static_cast<off_t>(end)) == 0 && remapLocked(end);
+            }
+        }
+    } else if (ok) {
+        ok = fail(error, "cannot map " + path_);
+    }
+    ::flock(fd_, LOCK_UN);
+    if (!ok) {
+        unmapLocked();
+        ::close(fd_);
+        fd_ = -1;
+        index_.clear();
+    }
+    return ok;
+}
+
+size_t TranscriptCache::indexLocked(size_t from) {
+    size_t pos = from;
+    while (pos + kRecordHeaderSize <= mapSize_) {
+        const unsigned char* r = map_ + pos;
+        const uint32_t size = load<uint32_t>(r);
+        const uint32_t text_len = load<uint32_t>(r + 36);
+        if (size < kRecordHeaderSize || size % 8 != 0 || pos + size > mapSize_ ||
+            kRecordHeaderSize + text_len > size ||
+            load<uint32_t>(r + 4) != checksum(r + 8, kRecordHeaderSize - 8 + text_len)) {
+            break;
+        }
+        index_[Key{ load<uint64_t>(r + 8), load<uint64_t>(r + 16) }] = Entry{ pos, ++clock_ };
+        pos += size;
+    }
+    indexedEnd_ = pos;
+    return pos;
+}
+
+bool TranscriptCache::refreshLocked() {
+    if (fd_ < 0) return false;
+    struct stat st;
+    if (::stat(path_.c_str(), &st) != 0 || static_cast<uint64_t>(st.st_ino) != inode_) {
+        // Another process compacted the cache into a new file.
+        return reopenLocked(nullptr);
+    }
+    const size_t size = file_size(fd_);
+    if (size <= indexedEnd_) return true;
+    if (!remapLocked(size)) return false;
+    indexLocked(indexedEnd_);
+    return true;
+}
+
+bool TranscriptCache::lookup(const Key& key, TranscriptionResult& out) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (fd_ < 0) return false;
+    auto it = index_.find(key);
+    if (it == index_.end() && refreshLocked()) it = index_.find(key);
+    static metrics::Counter& hit_count = metrics::counter("rose_cache_hits_total", "Transcript cache hits.");
+    static metrics::Counter& miss_count = metrics::counter("rose_cache_misses_total", "Transcript cache misses.");
+    if (it == index_.end()) {
+        ++misses_;
+        miss_count.add();
+        return false;
+    }
+
+    const unsigned char* r = map_ + it->second.offset;
+    out.avg_logprob = load<float>(r + 24);
+    out.no_speech_prob = load<float>(r + 28);
+    out.score = load<float>(r + 32);
+    out.text.assign(reinterpret_cast<const char*>(r + kRecordHeaderSize), load<uint32_t>(r + 36));
+    out.segments.clear();
+    it->second.used = ++clock_;
+    ++hits_;
+    hit_count.add();
+    return true;
+}
+
+void TranscriptCache::store(const Key& key, const TranscriptionResult& result) {
+    const size_t size = (kRecordHeaderSize + result.text.size() + 7) & ~size_t(7);
+    std::vector<unsigned char> record(size, 0);
+    put<uint32_t>(record, 0, static_cast<uint32_t>(size));
+    put<uint64_t>(record, 8, key.hi);
+    put<uint64_t>(record, 16, key.lo);
+    put<float>(record, 24, result.avg_logprob);
+    put<float>(record, 28, result.no_speech_prob);
+    put<float>(record, 32, result.score);
+    put<uint32_t>(record, 36, static_cast<uint32_t>(result.text.size()));
+    std::memcpy(record.data() + kRecordHeaderSize, result.text.data(), result.text.size());
+    put<uint32_t>(record, 4, checksum(record.data() + 8, kRecordHeaderSize - 8 + result.text.size()));
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    // Lock the file that is at `path_` right now; a compaction elsewhere may
+    // have replaced the one we hold.
+    while (true) {
+        if (fd_ < 0) return;
+        ::flock(fd_, LOCK_EX);
+        struct stat st;
+        if (::stat(path_.c_str(), &st) == 0 && static_cast<uint64_t>(st.st_ino) == inode_) break;
+        ::flock(fd_, LOCK_UN);
+        if (!reopenLocked(nullptr)) return;
+    }
+
+    if (write_all(fd_, record.data(), record.size()) && remapLocked(file_size(fd_))) {
+        indexLocked(indexedEnd_);
+        if (mapSize_ > maxBytes_) compactLocked();
+    }
+    if (fd_ >= 0) ::flock(fd_, LOCK_UN);
+}
+
+void TranscriptCache::compactLocked() {
+    // Keep the most recently used entries up to three quarters of the cap, in
+    // their original append order.
+    std::vector<std::pair<Key, Entry>> live(index_.begin(), index_.end());
+    std::sort(live.begin(), live.end(), [](const auto& x, const auto& y) { return x.second.used > y.second.used; });
+    size_t total = kFileHeaderSize;
+    size_t keep = 0;
+    for (; keep < live.size(); ++keep) {
+        const size_t size = load<uint32_t>(map_ + live[keep].second.offset);
+        if (total + size > maxBytes_ / 4 * 3) break;
+        total += size;
+    }
+    live.resize(keep);
+    std::sort(live.begin(), live.end(), [](const auto& x, const auto& y) { return x.second.offset < y.second.offset; });
+
+    const std::string tmp = path_ + ".tmp";
+    const int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) return;
+    bool ok = write_all(out, map_, kFileHeaderSize);
+    for (const auto& kv : live) {
+        if (!ok) break;
+        ok = write_all(out, map_ + kv.second.offset, load<uint32_t>(map_ + kv.second.offset));
+    }
+    ok = ::close(out) == 0 && ok;
+    if (!ok || ::rename(tmp.c_str(), path_.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return;
+    }
+
+    // Carry recency over to the new offsets.
+    std::unordered_map<Key, uint64_t, KeyHash> used;
+    for (const auto& kv : live) used[kv.first] = kv.second.used;
+    if (reopenLocked(nullptr)) {
+        for (auto& kv : index_) {
+            if (auto u = used.find(kv.first); u != used.end()) kv.second.used = u->second;
+        }
+    }
+}
+
+size_t TranscriptCache::entries() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return index_.size();
+}
+
+size_t TranscriptCache::bytes() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return indexedEnd_;
+}
+
+size_t TranscriptCache::hits() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return hits_;
+}
+
+size_t TranscriptCache::misses() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return misses_;
+}
@@ -0,0 +1,214 @@
+#include "TranscriptionServer.h"
+#include "Executor.h"
+#include "Json.h"
+#include "ThreadPolicy.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+double ms_between(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+} // namespace
+
+TranscriptionServer::Connection::~Connection() {
+    if (fd >= 0) ::close(fd);
+}
+
+TranscriptionServer::TranscriptionServer(WhisperProcessor& processor, ServerOptions options)
+    : processor_(processor),
+      options_(std::move(options)),
+      queue_({ std::max<size_t>(1, options_.max_batch), options_.short_seconds,
+               std::chrono::milliseconds(options_.batch_window_ms) }) {}
+
+TranscriptionServer::~TranscriptionServer() {
+    stop();
+}
+
+bool TranscriptionServer::start(std::string* error) {
+    listen_fd_ = ipc::listen_unix(options_.socket_path, error);
+    if (listen_fd_ < 0) return false;
+    for (int i = 0; i < std::max(1, options_.slots); ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+    acceptor_ = std::thread([this] { acceptLoop(); });
+    return true;
+}
+
+void TranscriptionServer::stop() {
+    if (stopping_.exchange(true)) return;
+    if (acceptor_.joinable()) acceptor_.join();
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        ::unlink(options_.socket_path.c_str());
+        listen_fd_ = -1;
+    }
+
+    queue_.close();
+    for (auto& w : workers_) w.join();
+    workers_.clear();
+
+    // Wake blocked readers; each removes its connection on the way out.
+    std::unique_lock<std::mutex> lk(conns_mutex_);
+    for (auto& kv : conns_) ::shutdown(kv.second->fd, SHUT_RDWR);
+    readers_done_.wait(lk, [this] { return conns_.empty(); });
+}
+
+void TranscriptionServer::acceptLoop() {
+    // Poll with a timeout rather than block in accept() so stop() needs no
+    // platform-specific way to interrupt it.
+    trace::setThreadName("daemon.accept");
+    while (!stopping_.load()) {
+        pollfd pfd { listen_fd_, POLLIN, 0 };
+        if (::poll(&pfd, 1, 200) <= 0) continue;
+        const int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) continue;
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof one);
+#endif
+        auto conn = std::make_shared<Connection>();
+        conn->id = next_client_.fetch_add(1);
+        conn->fd = fd;
+        {
+            std::lock_guard<std::mutex> lk(conns_mutex_);
+            conns_[conn->id] = conn;
+        }
+        std::thread([this, conn] { readLoop(conn); }).detach();
+    }
+}
+
+void TranscriptionServer::readLoop(std::shared_ptr<Connection> conn) {
+    trace::setThreadName("daemon.conn");
+    while (!stopping_.load()) {
+        ipc::Request request;
+        std::string error;
+        if (!ipc::read_request(conn->fd, request, &error)) {
+            // A malformed header leaves the stream unframed; report and hang up.
+            if (error != "connection closed") reply(*conn, request.id, ipc::Status::BadRequest, error);
+            break;
+        }
+
+        Job job;
+        job.conn = conn;
+        job.request_id = request.id;
+        job.received = std::chrono::steady_clock::now();
+        job.options = options_.defaults;
+        if (!request.language.empty()) job.options.language = request.language;
+        if (request.best_of > 0) {
+            job.options.bestOfN = std::clamp<int>(request.best_of, constants::kBestOfNMin, constants::kBestOfNMax);
+        }
+        if (!ipc::decode_audio(request, constants::kSampleRate, job.pcm, &error)) {
+            reply(*conn, request.id, ipc::Status::BadRequest, error);
+            continue;
+        }
+
+        const double seconds = static_cast<double>(job.pcm.size()) / constants::kSampleRate;
+        if (!queue_.push(conn->id, std::move(job), seconds, constants::kDaemonMaxQueuedPerClient)) {
+            if (stopping_.load()) reply(*conn, request.id, ipc::Status::Unavailable, "server shutting down");
+            else reply(*conn, request.id, ipc::Status::Busy, "too many requests queued");
+        }
+    }
+
+    conn->open.store(false);
+    queue_.drop(conn->id);
+    std::lock_guard<std::mutex> lk(conns_mutex_);
+    conns_.erase(conn->id);
+    readers_done_.notify_all();
+}
+
+void TranscriptionServer::workerLoop() {
+    trace::setThreadName("daemon.slot");
+    (void)sched::apply(sched::Role::Decode);
+    // Groups and their candidates run here, not on Executor::shared(), where
+    // every slot's candidates would compete for one hardware-sized pool.
+    rose::Executor decoders(static_cast<unsigned>(std::max(1, options_.defaults.bestOfN)), sched::Role::Decode);
+    while (true) {
+        std::vector<Job> batch = queue_.pop();
+        if (batch.empty()) return;
+        batch.erase(std::remove_if(batch.begin(), batch.end(),
+                                   [](const Job& j) { return !j.conn->open.load(); }),
+                    batch.end());
+        if (!batch.empty()) runBatch(batch, decoders);
+    }
+}
+
+void TranscriptionServer::runBatch(std::vector<Job>& batch, rose::Executor& decoders) {
+    trace::Span span("daemon.batch", static_cast<int64_t>(batch.size()));
+    // Clips asking for the same language and candidate count share encoder
+    // windows; the rest decode alone. Groups split the slot's threads.
+    std::vector<std::vector<size_t>> groups;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        auto same = [&](const std::vector<size_t>& g) {
+            const DecodeOptions& o = batch[g.front()].options;
+            return options_.pack && o.language == batch[i].options.language && o.bestOfN == batch[i].options.bestOfN;
+        };
+        auto it = std::find_if(groups.begin(), groups.end(), same);
+        if (it == groups.end()) groups.push_back({ i });
+        else it->push_back(i);
+    }
+
+    const int n = static_cast<int>(batch.size());
+    const int threads = std::max(1, options_.slot_threads / static_cast<int>(groups.size()));
+    const auto started = std::chrono::steady_clock::now();
+
+    rose::TaskGroup tasks(decoders);
+    for (const auto& group : groups) {
+        tasks.run([this, &batch, &group, &decoders, threads, n, started]() {
+            DecodeOptions opts = batch[group.front()].options;
+            opts.threads = threads;
+            opts.executor = &decoders;
+            std::vector<TranscriptionResult> results;
+            if (group.size() == 1) {
+                results.push_back(processor_.decode(processor_.prepare(batch[group.front()].pcm), opts));
+            } else {
+                std::vector<std::vector<float>> prepared;
+                for (size_t i : group) prepared.push_back(processor_.prepare(batch[i].pcm));
+                results = processor_.decodePacked(prepared, opts);
+            }
+            const auto done = std::chrono::steady_clock::now();
+
+            for (size_t k = 0; k < group.size(); ++k) {
+                const Job& job = batch[group[k]];
+                const TranscriptionResult& r = results[k];
+                std::ostringstream body;
+                body << "{\"text\":" << json::quote(r.text)
+                     << ",\"avg_logprob\":" << json::number(r.avg_logprob)
+                     << ",\"no_speech_prob\":" << json::number(r.no_speech_prob)
+                     << ",\"duration_s\":" << json::number(static_cast<double>(job.pcm.size()) / constants::kSampleRate)
+                     << ",\"queue_ms\":" << json::number(ms_between(job.received, started))
+                     << ",\"decode_ms\":" << json::number(ms_between(started, done))
+                     << ",\"batch\":" << n << ",\"packed\":" << group.size();
+                if (r.truncated) body << ",\"truncated\":true";
+                if (r.degenerate) body << ",\"degenerate\":true";
+                body << "}";
+                reply(*job.conn, job.request_id, ipc::Status::Ok, body.str());
+            }
+        });
+    }
+    tasks.wait();
+
+    if (n > 1) {
+        std::cout << "[rose] daemon: batch of " << n << " (" << groups.size() << " decodes) in "
+                  << ms_between(started, std::chrono::steady_clock::now()) << " ms\n";
+    }
+}
+
+void TranscriptionServer::reply(Connection& conn, uint32_t id, ipc::Status status, const std::string& body) {
+    ipc::Response response;
+    response.id = id;
+    response.status = status;
+    response.body = status == ipc::Status::Ok ? body : "{\"error\":" + json::quote(body) + "}";
+    std::lock_guard<std::mutex> lk(conn.write_mutex);
+    if (conn.open.load() && !ipc::write_message(conn.fd, ipc::encode_response(response))) {
+        conn.open.store(false);
+    }
+}
@@ -2,6 +2,7 @@
 #include "whisper.h"
 
 bool WhisperContext::initialize(const std::string& model_path, bool use_gpu) {
+    clearPool();
     ctx_.reset();
     whisper_context_params cparams = whisper_context_default_params();
     cparams.use_gpu = use_gpu;
@@ -25,6 +26,50 @@ void WhisperContext::State::deleter(whisper_state* s) {
     if (s) whisper_free_state(s);
 }
 
+WhisperContext::StateLease WhisperContext::acquireState() {
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lk(pool_mutex_);
+        generation = generation_;
+        if (!pool_.empty()) {
+            State s = std::move(pool_.back());
+            pool_.pop_back();
+            return StateLease{*this, std::move(s), generation};
+        }
+    }
+    return StateLease{*this, createState(), generation};
+}
+
+void WhisperContext::reserveStates(size_t count) {
+    while (pooledStates() < count) {
+        State s = createState();
+        if (!s) return;
+        std::lock_guard<std::mutex> lk(pool_mutex_);
+        pool_.push_back(std::move(s));
+    }
+}
+
+size_t WhisperContext::pooledStates() const {
+    std::lock_guard<std::mutex> lk(pool_mutex_);
+    return pool_.size();
+}
+
+void WhisperContext::releaseState(State state, uint64_t generation) {
+    std::lock_guard<std::mutex> lk(pool_mutex_);
+    if (generation != generation_ || !ctx_) return;
+    pool_.push_back(std::move(state));
+}
+
+void WhisperContext::clearPool() {
+    std::vector<State> doomed;
+    {
+        std::lock_guard<std::mutex> lk(pool_mutex_);
+        doomed.swap(pool_);
+        ++generation_;
+    }
+}
+
 void WhisperContext::reset() {
+    clearPool();
     ctx_.reset();
 }
@@ -2,22 +2,238 @@
 #include "Settings.h"
 #include "Constants.h"
 #include "AudioUtils.h"
+#include "ClipPacking.h"
 #include "TextScoring.h"
 #include "WhisperContext.h"
+#include "Executor.h"
+#include "Metrics.h"
+#include "RunawayGuard.h"
+#include "Trace.h"
 #include "whisper.h"
 #include <cmath>
+#include <filesystem>
 #include <algorithm>
+#include <chrono>
 #include <thread>
-#include <future>
 #include <limits>
+#include <random>
 #include <iostream>
 
 WhisperProcessor::WhisperProcessor() = default;
 
 WhisperProcessor::~WhisperProcessor() = default;
 
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+double ms_between(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+// The decoder filters logits before every sampled token, so the first call
+// marks the end of the encoder pass.
+struct FirstLogits {
+    std::chrono::steady_clock::time_point at;
+    bool seen = false;
+
+    static void callback(whisper_context*, whisper_state*, const whisper_token_data*, int, float*, void* user) {
+        auto* self = static_cast<FirstLogits*>(user);
+        if (!self->seen) {
+            self->seen = true;
+            self->at = std::chrono::steady_clock::now();
+        }
+    }
+};
+
+// whisper's abort callback, polled between graph nodes; true stops the decode.
+struct DeadlineAbort {
+    std::chrono::steady_clock::time_point deadline;
+    bool fired = false;
+
+    static bool callback(void* user) {
+        auto* self = static_cast<DeadlineAbort*>(user);
+        if (!self->fired && std::chrono::steady_clock::now() >= self->deadline) self->fired = true;
+        return self->fired;
+    }
+};
+
+// whisper's new-segment callback: appends the committed segments and hands
+// the text so far to DecodeOptions::onPartial.
+struct PartialText {
+    const std::function<void(const std::string&)>* sink;
+    std::string text;
+
+    static void callback(whisper_context*, whisper_state* state, int n_new, void* user) {
+        auto* self = static_cast<PartialText*>(user);
+        const int n_segments = whisper_full_n_segments_from_state(state);
+        for (int i = std::max(0, n_segments - n_new); i < n_segments; ++i) {
+            const char* text = whisper_full_get_segment_text_from_state(state, i);
+            if (!text || !text[0]) continue;
+            if (!self->text.empty() && self->text.back() != ' ') self->text += " ";
+            self->text += text;
+        }
+        if (n_new > 0 && !self->text.empty()) (*self->sink)(self->text);
+    }
+};
+
+// whisper's side of rose::RunawayGuard. It holds whisper's only slot for the
+// logits-filter, new-segment and abort callbacks, so it forwards to the
+// first-logits timer, the partial-text sink and the deadline when in use; a
+// tripped guard aborts at the next graph node.
+struct RunawayCallbacks {
+    rose::RunawayGuard guard;
+    FirstLogits* first = nullptr;
+    PartialText* partial = nullptr;
+    DeadlineAbort* deadline = nullptr;
+
+    static void logits(whisper_context* ctx, whisper_state* state, const whisper_token_data* tokens,
+                       int n_tokens, float* logits, void* user) {
+        auto* self = static_cast<RunawayCallbacks*>(user);
+        if (self->first) FirstLogits::callback(ctx, state, tokens, n_tokens, logits, self->first);
+        self->guard.sampling(n_tokens);
+    }
+
+    static void segment(whisper_context* ctx, whisper_state* state, int n_new, void* user) {
+        auto* self = static_cast<RunawayCallbacks*>(user);
+        if (self->guard.fired()) return;  // whisper may still commit the window it was in
+        const int n_segments = whisper_full_n_segments_from_state(state);
+        for (int i = std::max(0, n_segments - n_new); i < n_segments; ++i) {
+            const char* text = whisper_full_get_segment_text_from_state(state, i);
+            self->guard.committed(text ? text : "", whisper_full_n_tokens_from_state(state, i));
+        }
+        if (self->partial && !self->guard.looping()) PartialText::callback(ctx, state, n_new, self->partial);
+    }
+
+    static bool abort(void* user) {
+        auto* self = static_cast<RunawayCallbacks*>(user);
+        return self->guard.fired() || (self->deadline && DeadlineAbort::callback(self->deadline));
+    }
+};
+
+// Softmax probability of `token` among logits [0, n).
+double softmaxProb(const float* logits, int n, int token) {
+    const float max_logit = *std::max_element(logits, logits + n);
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) sum += std::exp(static_cast<double>(logits[i] - max_logit));
+    return std::exp(static_cast<double>(logits[token] - max_logit)) / sum;
+}
+
+// Dead air inside a clip, cut once before every encoder pass.
+audio::Compacted compactClip(const std::vector<float>& prepared, bool enabled) {
+    if (!enabled) return {};
+    return audio::compact_pauses(prepared, constants::kSampleRate, constants::kPauseFrameMs,
+                                 constants::kPauseMinMs, constants::kPauseKeepMs,
+                                 constants::kPauseRelativeRms, constants::kPauseQuietRms);
+}
+
+} // namespace
+
+DecodeOptions DecodeOptions::fromSettings() {
+    // One snapshot, so a settings change mid-read cannot mix two configurations.
+    const auto snap = Settings::getInstance().snapshot();
+    const Settings::Values& settings = *snap;
+    DecodeOptions options;
+    options.language = settings.language;
+    options.useLanguageSession = true;
+    options.bestOfN = settings.bestOfN;
+    options.threads = settings.decodeThreads();
+    if (settings.latencyTargetMs > constants::kLatencyTargetOff) {
+        options.deadlineMs = static_cast<int>(settings.latencyTargetMs * constants::kDeadlineTargetMultiple);
+    }
+    return options;
+}
+
 bool WhisperProcessor::initialize(const std::string& modelPath) {
-    return context.initialize(modelPath, constants::kUseGPU);
+    return initialize(modelPath, constants::kUseGPU);
+}
+
+bool WhisperProcessor::initialize(const std::string& modelPath, bool useGpu) {
+    trace::Span span("model.load");
+    const auto t0 = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lk(statsMutex);
+        stats = LatencyStats{};
+    }
+    dropEncoded();
+    if (!context.initialize(modelPath, useGpu)) return false;
+    languageSession.reset();
+    static metrics::Counter& loads = metrics::counter("rose_model_loads_total", "Models loaded into memory.");
+    static metrics::Histogram& load_seconds =
+        metrics::histogram("rose_model_load_seconds", "Time to load a model file.");
+    loads.add();
+    load_seconds.observe(elapsed_ms(t0) / 1000.0);
+    std::error_code ec;
+    const auto bytes = std::filesystem::file_size(modelPath, ec);
+    modelId = std::filesystem::path(modelPath).filename().string() + ":" + std::to_string(ec ? 0 : bytes);
+    std::lock_guard<std::mutex> lk(statsMutex);
+    stats.load_ms = elapsed_ms(t0);
+    return true;
+}
+
+LatencyStats WhisperProcessor::latencyStats() const {
+    std::lock_guard<std::mutex> lk(statsMutex);
+    return stats;
+}
+
+int WhisperProcessor::candidateCount(const DecodeOptions& options) const {
+    const auto& temperatures = constants::Temperatures();
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    int cap = static_cast<int>(hw);
+    if (options.gpu) cap = 2;
+    return std::max(1, std::min(options.bestOfN, std::min(static_cast<int>(temperatures.size()), cap)));
+}
+
+bool WhisperProcessor::warmUp(const DecodeOptions& options) {
+    if (!context.valid()) return false;
+    trace::Span span("model.warmup");
+    const auto t0 = std::chrono::steady_clock::now();
+
+    // Low-level deterministic noise; whisper pads to a full window so the encoder
+    // runs at its real cost while the decoder stops after a few tokens.
+    std::vector<float> synthetic(static_cast<size_t>(constants::kWarmupSamples));
+    uint32_t seed = 0x9e3779b9u;
+    for (float& s : synthetic) {
+        seed = seed * 1664525u + 1013904223u;
+        s = (static_cast<float>(seed >> 8) / static_cast<float>(1u << 24) - 0.5f) * 1e-3f;
+    }
+
+    bool ok = false;
+    {
+        auto state = context.acquireState();
+        if (!state) return false;
+
+        whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+        params.print_progress = false;
+        params.print_special = false;
+        params.print_realtime = false;
+        params.print_timestamps = false;
+        params.single_segment = true;
+        params.no_timestamps = true;
+        params.no_context = true;
+        params.detect_language = false;
+        params.language = "en";
+        params.n_threads = options.threads;
+        params.max_tokens = constants::kWarmupMaxTokens;
+        ok = whisper_full_with_state(context.get(), state.get(), params,
+                                     synthetic.data(), static_cast<int>(synthetic.size())) == 0;
+    }
+
+    // Remaining candidates get their compute buffers allocated up front too.
+    context.reserveStates(static_cast<size_t>(candidateCount(options)));
+
+    const double warmup_ms = elapsed_ms(t0);
+    {
+        std::lock_guard<std::mutex> lk(statsMutex);
+        stats.warmup_ms = warmup_ms;
+    }
+    if (logging) {
+        std::cout << "[rose] warm-up: " << static_cast<int>(warmup_ms) << " ms ("
+                  << context.pooledStates() << " states)\n";
+    }
+    return ok;
 }
 
 std::vector<float> WhisperProcessor::applyHighPassFilter(const std::vector<float>& audioData) {
@@ -48,19 +264,34 @@ std::vector<float> WhisperProcessor::preprocessAudio(const std::vector<float>& a
 }
 
 TranscriptionResult WhisperProcessor::runTranscription(
-    const std::vector<float>& audioData, float temperature) {
+    const std::vector<float>& audioData, float temperature, const DecodeOptions& options,
+    std::chrono::steady_clock::time_point deadline, StageTimings* timings) {
 
+    // Temperature in hundredths identifies the candidate.
+    trace::Span span("candidate", static_cast<int64_t>(std::lround(temperature * 100.0f)));
     TranscriptionResult result;
     result.text = "";
     result.avg_logprob = -std::numeric_limits<float>::infinity();
     result.no_speech_prob = 0.0f;
-    result.score = 0.0f;
+    // A candidate that never ran ranks below any that produced text, even
+    // text cut off at the deadline.
+    result.score = -std::numeric_limits<float>::infinity();
 
     if (!context.valid() || audioData.empty()) {
         return result;
     }
+    // A candidate still queued when time runs out is not started at all.
+    if (std::chrono::steady_clock::now() >= deadline) {
+        result.truncated = true;
+        return result;
+    }
 
-    auto state = context.createState();
+    const auto t_state = std::chrono::steady_clock::now();
+    auto state = [this] {
+        trace::Span acquire("state.acquire");
+        return context.acquireState();
+    }();
+    if (timings) timings->state_ms = elapsed_ms(t_state);
     if (!state) return result;
 
     whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
@@ -70,7 +301,7 @@ TranscriptionResult WhisperProcessor::runTranscription(
     params.print_timestamps = false;
     params.single_segment = false;
     params.no_context = false;
-    const std::string lang = Settings::getInstance().getLanguage();
+    const std::string& lang = options.language;
     if (lang == "auto" || lang.empty()) {
         params.detect_language = true;
         params.language = nullptr;
@@ -78,20 +309,78 @@ TranscriptionResult WhisperProcessor::runTranscription(
         params.detect_language = false;
         params.language = lang.c_str();
     }
-    params.n_threads = constants::kWhisperThreads;
+    params.n_threads = options.threads;
     params.temperature = temperature;
+    // Candidates already span the temperatures; whisper's own fallback would
+    // re-decode windows inside one candidate at a cost nobody budgeted.
+    params.temperature_inc = 0.0f;
     params.suppress_blank = true;
     params.suppress_nst = true;
     params.max_initial_ts = constants::kWhisperMaxInitialTs;
     params.entropy_thold = constants::kWhisperEntropyThold;
     params.logprob_thold = constants::kWhisperLogprobThold;
     params.greedy.best_of = constants::kWhisperGreedyBestOf;
+    if (options.wordSegments) {
+        params.token_timestamps = true;
+        params.max_len = 1;
+        params.split_on_word = true;
+    }
+
+    const double seconds = static_cast<double>(audioData.size()) / constants::kSampleRate;
+    RunawayCallbacks guard{ rose::RunawayGuard(static_cast<int64_t>(
+        constants::kRunawayTokenSlack + constants::kRunawayTokensPerSecond * seconds)) };
+    params.logits_filter_callback = &RunawayCallbacks::logits;
+    params.logits_filter_callback_user_data = &guard;
+    params.new_segment_callback = &RunawayCallbacks::segment;
+    params.new_segment_callback_user_data = &guard;
+    params.abort_callback = &RunawayCallbacks::abort;
+    params.abort_callback_user_data = &guard;
+
+    DeadlineAbort abort{ deadline };
+    if (deadline != std::chrono::steady_clock::time_point::max()) guard.deadline = &abort;
+
+    // Only the T=0 candidate streams; it is the one most often chosen.
+    PartialText partial{ &options.onPartial, {} };
+    if (options.onPartial && temperature == constants::Temperatures().front()) guard.partial = &partial;
+
+    FirstLogits firstLogits;
+    if (timings) guard.first = &firstLogits;
 
-    if (whisper_full_with_state(context.get(), state.get(), params, audioData.data(), audioData.size()) == 0) {
+    const auto t_full = std::chrono::steady_clock::now();
+    static metrics::Histogram& candidate_seconds = metrics::histogram(
+        "rose_candidate_decode_seconds", "whisper_full time of one temperature candidate.");
+    int rc;
+    {
+        trace::Span full("whisper_full", static_cast<int64_t>(audioData.size()));
+        rc = whisper_full_with_state(context.get(), state.get(), params, audioData.data(), audioData.size());
+    }
+    candidate_seconds.observe(elapsed_ms(t_full) / 1000.0);
+    if (timings) {
+        const auto t_end = std::chrono::steady_clock::now();
+        const auto t_first = firstLogits.seen ? firstLogits.at : t_end;
+        timings->encode_ms = ms_between(t_full, t_first);
+        timings->decode_ms = ms_between(t_first, t_end);
+    }
+
+    // An aborted decode keeps the segments of the windows it finished; a
+    // runaway one only those before its loop.
+    result.degenerate = guard.guard.fired();
+    result.truncated = rc != 0 && abort.fired && !result.degenerate;
+    if (result.degenerate) {
+        static metrics::Counter& token_caps = metrics::counter(
+            "rose_runaway_token_cap_total", "Candidates aborted for sampling more tokens than their clip could hold.");
+        static metrics::Counter& loops = metrics::counter(
+            "rose_runaway_repetition_total", "Candidates aborted for repeating an n-gram in a loop.");
+        (guard.guard.looping() ? loops : token_caps).add();
+        trace::instant(guard.guard.looping() ? "runaway.repetition" : "runaway.token_cap", guard.guard.tokens());
+    }
+    if (rc == 0 || result.truncated || result.degenerate) {
+        trace::Span scoring("scoring");
         const int n_segments = whisper_full_n_segments_from_state(state.get());
 
         float total_logprob = 0.0f;
         int total_tokens = 0;
+        std::vector<size_t> segment_at;    // where each segment starts in result.text
 
         for (int i = 0; i < n_segments; ++i) {
             const char* text = whisper_full_get_segment_text_from_state(state.get(), i);
@@ -99,7 +388,13 @@ TranscriptionResult WhisperProcessor::runTranscription(
                 if (!result.text.empty() && result.text.back() != ' ') {
                     result.text += " ";
                 }
+                segment_at.push_back(result.text.size());
                 result.text += text;
+                // whisper timestamps are in 10 ms units
+                result.segments.push_back(TranscriptSegment{
+                    text,
+                    whisper_full_get_segment_t0_from_state(state.get(), i) * 10,
+                    whisper_full_get_segment_t1_from_state(state.get(), i) * 10 });
             }
 
             result.no_speech_prob = std::max(result.no_speech_prob,
@@ -119,6 +414,20 @@ TranscriptionResult WhisperProcessor::runTranscription(
             result.avg_logprob = total_logprob / total_tokens;
         }
 
+        const size_t loop = result.degenerate
+            ? textscore::repetition_start(result.text, constants::kRepeatMaxNgram,
+                                          constants::kRepeatMinRepeats, constants::kRepeatMinWords)
+            : std::string::npos;
+        if (loop != std::string::npos) {
+            result.text.erase(loop);
+            while (!result.text.empty() && result.text.back() == ' ') result.text.pop_back();
+            while (!segment_at.empty() && segment_at.back() >= result.text.size()) {
+                segment_at.pop_back();
+                result.segments.pop_back();
+            }
+            if (!segment_at.empty()) result.segments.back().text = result.text.substr(segment_at.back());
+        }
+
         result.score = textscore::score(result.avg_logprob, result.no_speech_prob);
     }
 
@@ -135,16 +444,38 @@ TranscriptionResult WhisperProcessor::selectBestResult(
 }
 
 std::string WhisperProcessor::transcribe(const std::vector<float>& audioData) {
-    if (!context.valid() || audioData.empty()) {
+    if (!context.valid()) {
         return "";
     }
+    return decode(prepare(audioData));
+}
+
+TranscriptionResult WhisperProcessor::transcribe(const std::vector<float>& audioData,
+                                                 const DecodeOptions& options,
+                                                 StageTimings* timings) {
+    const auto t0 = std::chrono::steady_clock::now();
+    const std::vector<float> prepared = prepare(audioData);
+    const double preprocess_ms = elapsed_ms(t0);
+    TranscriptionResult result = decode(prepared, options, timings);
+    if (timings) {
+        timings->preprocess_ms = preprocess_ms;
+        timings->total_ms = elapsed_ms(t0);
+    }
+    return result;
+}
+
+std::vector<float> WhisperProcessor::prepare(const std::vector<float>& audioData) {
+    if (audioData.empty()) {
+        return {};
+    }
+    trace::Span span("preprocess", static_cast<int64_t>(audioData.size()));
 
     std::vector<float> processed = preprocessAudio(audioData);
 
     bool sufficient_length = processed.size() >= static_cast<size_t>(constants::kSampleRate / 2);
     bool vad_ok = detectVoiceActivity(processed);
 
-    if (constants::kDebugLogging) {
+    if (constants::kDebugLogging && logging) {
         // Compute simple energy/ZCR stats for visibility
         float energy = 0.0f;
         for (float s : processed) energy += s * s;
@@ -171,49 +502,577 @@ std::string WhisperProcessor::transcribe(const std::vector<float>& audioData) {
         // Fallback: only high-pass + normalize; skip silence trim + VAD gate
         auto hp = applyHighPassFilter(audioData);
         to_transcribe = normalizeAudio(hp);
-        if (constants::kDebugLogging) {
+        if (constants::kDebugLogging && logging) {
             std::cout << "[rose] fallback enabled (permissive preprocessing)\n";
         }
         if (to_transcribe.size() < static_cast<size_t>(constants::kSampleRate / 2)) {
-            return "";
+            return {};
+        }
+    }
+
+    return to_transcribe;
+}
+
+std::string WhisperProcessor::decode(const std::vector<float>& prepared) {
+    TranscriptionResult best = decode(prepared, DecodeOptions::fromSettings());
+
+    if (best.no_speech_prob > constants::kNoSpeechProbThreshold && best.text.empty()) {
+        return "";
+    }
+
+    return best.text;
+}
+
+TranscriptionResult WhisperProcessor::decode(const std::vector<float>& prepared,
+                                             const DecodeOptions& options,
+                                             StageTimings* timings) {
+    if (!context.valid() || prepared.empty()) {
+        return selectBestResult({});
+    }
+
+    // A kept encoding goes back to the pool at the next decode, before the
+    // candidates need states; a retranscribe in between is what it is for.
+    uint64_t kept_serial = 0;
+    {
+        std::lock_guard<std::mutex> lk(lastMutex);
+        last.encoded.reset();
+        if (options.keepForRetranscribe) {
+            last.prepared = prepared;
+            last.language.clear();
+            kept_serial = ++last.serial;
+        }
+    }
+
+    // Packed windows are never cached: their segments are needed to split them.
+    const bool cacheable = cache && !options.wordSegments;
+    TranscriptCache::Key key;
+    if (cacheable) {
+        key = TranscriptCache::makeKey(prepared, modelId, options.language, options.bestOfN);
+        TranscriptionResult hit;
+        if (cache->lookup(key, hit)) return hit;
+    }
+
+    const auto t_start = std::chrono::steady_clock::now();
+    const auto deadline = options.deadlineMs > 0
+        ? t_start + std::chrono::milliseconds(options.deadlineMs)
+        : std::chrono::steady_clock::time_point::max();
+
+    const audio::Compacted compacted = compactClip(prepared, options.compactPauses);
+    const std::vector<float>& to_transcribe = compacted.offsets.empty() ? prepared : compacted.audio;
+    if (!compacted.offsets.empty()) {
+        static metrics::Counter& cut_ms = metrics::counter(
+            "rose_pause_compacted_ms_total", "Milliseconds of interior pauses cut before decoding.");
+        const size_t cut = prepared.size() - to_transcribe.size();
+        cut_ms.add(cut * 1000 / constants::kSampleRate);
+        if (constants::kDebugLogging && logging) {
+            std::cout << "[rose] compacted pauses: " << prepared.size() * 1000 / constants::kSampleRate
+                      << " -> " << to_transcribe.size() * 1000 / constants::kSampleRate << " ms\n";
         }
     }
 
-    int bestOfN = Settings::getInstance().getBestOfN();
-    std::vector<std::future<TranscriptionResult>> futures;
     const auto& temperatures = constants::Temperatures();
-    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
-    int cap = static_cast<int>(hw);
-    if (constants::kUseGPU) cap = 2;
-    const int max_tasks = std::min(bestOfN, std::min(static_cast<int>(temperatures.size()), cap));
+    const int max_tasks = candidateCount(options);
 
-    for (int i = 0; i < max_tasks; ++i) {
-        futures.push_back(std::async(std::launch::async,
-            [this, &to_transcribe, temp = temperatures[i]]() {
-                return runTranscription(to_transcribe, temp);
-            }));
+    // The language is detected once here rather than by every candidate on
+    // the same audio, and a silent clip ends before any candidate starts.
+    const bool autoLanguage = options.language == "auto" || options.language.empty();
+    const bool probeSpeech = options.noSpeechProbe &&
+        (autoLanguage || max_tasks >= constants::kNoSpeechProbeMinCandidates);
+    // A kept clip of one window keeps the probe's encoding too.
+    std::unique_ptr<WhisperContext::StateLease> encoded;
+    const bool oneWindow =
+        to_transcribe.size() <= static_cast<size_t>(constants::kSampleRate) * constants::kWhisperWindowSeconds;
+    const bool keepEncoded = options.keepForRetranscribe && oneWindow;
+    const ClipProbe probe = probeClip(to_transcribe, options, probeSpeech, keepEncoded ? &encoded : nullptr);
+    if (encoded) {
+        std::lock_guard<std::mutex> lk(lastMutex);
+        if (last.serial == kept_serial) {
+            last.encoded = std::move(encoded);
+            if (probe.language != "auto" && (options.language == "auto" || options.language.empty())) {
+                last.language = probe.language;
+            }
+        }
+    }
+    // Only a clip the probed window covers whole, as the rest was not heard.
+    if (oneWindow && probe.no_speech_prob > constants::kNoSpeechProbThreshold &&
+        probe.first_logprob < constants::kWhisperLogprobThold) {
+        static metrics::Counter& skips = metrics::counter(
+            "rose_nospeech_probe_skips_total", "Clips found silent by the probe; no candidates decoded.");
+        skips.add();
+        probe_skips.fetch_add(1, std::memory_order_relaxed);
+        TranscriptionResult silent = selectBestResult({});
+        silent.no_speech_prob = probe.no_speech_prob;
+        recordLatency(elapsed_ms(t_start));
+        if (timings) timings->total_ms = elapsed_ms(t_start);
+        if (cacheable) cache->store(key, silent);
+        if (constants::kDebugLogging && logging) {
+            std::cout << "[rose] probe: no speech (p=" << probe.no_speech_prob << "), skipped decode\n";
+        }
+        return silent;
     }
+    DecodeOptions resolved = options;
+    resolved.language = probe.language;
 
-    std::vector<TranscriptionResult> results;
-    for (auto& future : futures) {
-        results.push_back(future.get());
+    std::vector<TranscriptionResult> results(static_cast<size_t>(max_tasks));
+    std::vector<StageTimings> stages(timings ? results.size() : 0);
+    {
+        rose::TaskGroup candidates(options.executor ? *options.executor : rose::Executor::shared());
+        for (int i = 0; i < max_tasks; ++i) {
+            StageTimings* stage = timings ? &stages[i] : nullptr;
+            candidates.run([this, &to_transcribe, &resolved, &out = results[i], temp = temperatures[i], deadline, stage]() {
+                out = runTranscription(to_transcribe, temp, resolved, deadline, stage);
+            });
+        }
+        candidates.wait();
     }
 
-    TranscriptionResult best = selectBestResult(results);
+    const auto t_score = std::chrono::steady_clock::now();
+    TranscriptionResult best;
+    {
+        trace::Span select("select_best", max_tasks);
+        best = selectBestResult(results);
+    }
+    for (TranscriptSegment& seg : best.segments) {
+        seg.t0_ms = compacted.offsets.originalMs(seg.t0_ms, constants::kSampleRate);
+        seg.t1_ms = compacted.offsets.originalMs(seg.t1_ms, constants::kSampleRate);
+    }
+    recordLatency(elapsed_ms(t_start));
+    if (probe.from_session && !best.truncated && !best.degenerate) languageSession.decoded(best.avg_logprob);
+    static metrics::Histogram& rtf = metrics::histogram(
+        "rose_decode_rtf", "Decode time over audio duration (real-time factor).", 1e3);
+    rtf.observe(elapsed_ms(t_start) / 1000.0 / (static_cast<double>(prepared.size()) / constants::kSampleRate));
+    if (timings) {
+        for (const StageTimings& s : stages) {
+            timings->state_ms = std::max(timings->state_ms, s.state_ms);
+            timings->encode_ms = std::max(timings->encode_ms, s.encode_ms);
+            timings->decode_ms = std::max(timings->decode_ms, s.decode_ms);
+        }
+        timings->scoring_ms = elapsed_ms(t_score);
+        timings->total_ms = elapsed_ms(t_start);
+    }
+    if (best.degenerate && logging) {
+        std::cout << "[rose] every candidate looped; text cut before the repetition\n";
+    }
+    if (best.truncated) {
+        static metrics::Counter& truncations = metrics::counter(
+            "rose_decode_deadline_truncations_total", "Decodes cut off at their deadline.");
+        truncations.add();
+        if (logging) {
+            std::cout << "[rose] decode cut off at " << options.deadlineMs << " ms deadline"
+                      << (best.text.empty() ? " (no text)" : " (partial text)") << "\n";
+        }
+    } else if (cacheable && !best.degenerate) {
+        // The record has no room for the flag; a looping decode is not kept.
+        cache->store(key, best);
+    }
 
-    if (constants::kDebugLogging) {
+    if (constants::kDebugLogging && logging) {
         std::cout << "[rose] decode: avg_logprob=" << best.avg_logprob
                   << ", no_speech_prob=" << best.no_speech_prob
                   << ", text_len=" << best.text.size() << "\n";
     }
 
-    if (best.no_speech_prob > constants::kNoSpeechProbThreshold && best.text.empty()) {
-        return "";
+    return best;
+}
+
+WhisperProcessor::ClipProbe WhisperProcessor::probeClip(const std::vector<float>& audio,
+                                                       const DecodeOptions& options, bool noSpeech,
+                                                       std::unique_ptr<WhisperContext::StateLease>* keep) {
+    ClipProbe out;
+    out.language = options.language;
+    const bool detect = options.language == "auto" || options.language.empty();
+    whisper_context* ctx = context.get();
+    if (detect) {
+        if (!whisper_is_multilingual(ctx)) out.language = "en";
+        else out.language = options.useLanguageSession ? languageSession.cached() : std::string();
+        out.from_session = !out.language.empty() && whisper_is_multilingual(ctx);
+        if (out.from_session) {
+            static metrics::Counter& session_hits = metrics::counter(
+                "rose_language_session_hits_total", "Auto-language clips that reused the session language.");
+            session_hits.add();
+        }
     }
+    const bool need_language = out.language.empty();
+    if (!need_language && !noSpeech) return out;
 
-    return best.text;
+    trace::Span span("probe");
+    auto fail = [&out, need_language]() -> ClipProbe& {
+        if (need_language) out.language = "auto";   // candidates detect for themselves
+        out.no_speech_prob = -1.0f;
+        return out;
+    };
+    auto state = context.acquireState();
+    if (!state) return fail();
+    const int threads = options.threads;
+    if (whisper_pcm_to_mel_with_state(ctx, state.get(), audio.data(), static_cast<int>(audio.size()), threads) != 0) {
+        return fail();
+    }
+
+    // Detection encodes the first window itself; otherwise encode it here.
+    int lang_id = -1;
+    if (need_language) {
+        std::vector<float> probs(static_cast<size_t>(whisper_lang_max_id()) + 1, 0.0f);
+        lang_id = whisper_lang_auto_detect_with_state(ctx, state.get(), 0, threads, probs.data());
+        if (lang_id < 0 || lang_id > whisper_lang_max_id()) return fail();
+        out.language = whisper_lang_str(lang_id);
+        static metrics::Counter& detections = metrics::counter(
+            "rose_language_detections_total", "Auto-language clips that ran language detection.");
+        detections.add();
+        if (options.useLanguageSession) languageSession.detected(out.language, probs[static_cast<size_t>(lang_id)]);
+        if (constants::kDebugLogging && logging) {
+            std::cout << "[rose] language: " << out.language << " (p=" << probs[static_cast<size_t>(lang_id)] << ")\n";
+        }
+    } else {
+        if (whisper_encode_with_state(ctx, state.get(), 0, threads) != 0) return fail();
+        lang_id = whisper_lang_id(out.language.c_str());
+    }
+    // The no-speech step below leaves the encoder output as it is.
+    auto encoded = [&out, &state, keep]() -> ClipProbe& {
+        if (keep) *keep = std::make_unique<WhisperContext::StateLease>(std::move(state));
+        return out;
+    };
+    if (!noSpeech) return encoded();
+
+    // Same measure whisper_full uses: P(no-speech token) after the start-of-
+    // transcript token, before any logit filtering. One token per call, as in
+    // decodeEncoded().
+    int n_past = 0;
+    auto feed = [&](whisper_token token) {
+        return whisper_decode_with_state(ctx, state.get(), &token, 1, n_past++, threads) == 0;
+    };
+    if (!feed(whisper_token_sot(ctx))) {
+        out.no_speech_prob = -1.0f;
+        return encoded();
+    }
+    out.no_speech_prob = static_cast<float>(
+        softmaxProb(whisper_get_logits_from_state(state.get()), whisper_n_vocab(ctx), whisper_token_nosp(ctx)));
+
+    // whisper only drops a window that also decodes to nothing or to low-
+    // confidence text; the first text token stands in for that text.
+    if ((whisper_is_multilingual(ctx) &&
+         (!feed(whisper_token_lang(ctx, std::max(0, lang_id))) || !feed(whisper_token_transcribe(ctx)))) ||
+        !feed(whisper_token_not(ctx))) {
+        out.first_logprob = 0.0f;   // unknown: never enough to skip
+        return encoded();
+    }
+    const float* logits = whisper_get_logits_from_state(state.get());
+    const whisper_token eot = whisper_token_eot(ctx);
+    const whisper_token first = static_cast<whisper_token>(std::max_element(logits, logits + eot + 1) - logits);
+    out.first_logprob = first == eot
+        ? -std::numeric_limits<float>::infinity()
+        : static_cast<float>(std::log(softmaxProb(logits, eot + 1, first)));
+    return encoded();
+}
+
+TranscriptionResult WhisperProcessor::decodeEncoded(whisper_state* state, int lang_id, float temperature,
+                                                    int threads, uint32_t seed) {
+    trace::Span span("candidate.encoded", static_cast<int64_t>(std::lround(temperature * 100.0f)));
+    whisper_context* ctx = context.get();
+    TranscriptionResult result{"", -std::numeric_limits<float>::infinity(), 0.0f, 0.0f};
+
+    // One token per call: where a multi-token call leaves the last token's
+    // logits differs between whisper versions, a single token's does not.
+    int n_past = 0;
+    auto feed = [&](whisper_token token) {
+        return whisper_decode_with_state(ctx, state, &token, 1, n_past++, threads) == 0;
+    };
+    if (!feed(whisper_token_sot(ctx))) return result;
+    result.no_speech_prob = static_cast<float>(
+        softmaxProb(whisper_get_logits_from_state(state), whisper_n_vocab(ctx), whisper_token_nosp(ctx)));
+    if (whisper_is_multilingual(ctx) &&
+        (!feed(whisper_token_lang(ctx, lang_id)) || !feed(whisper_token_transcribe(ctx)))) {
+        return result;
+    }
+    if (!feed(whisper_token_not(ctx))) return result;
+
+    // Text tokens sit below end-of-text; timestamps and other specials above.
+    const whisper_token eot = whisper_token_eot(ctx);
+    const int max_tokens = whisper_n_text_ctx(ctx) / 2 - n_past;
+    std::vector<double> weights(static_cast<size_t>(eot) + 1);
+    std::mt19937 rng(seed);
+    double logprob = 0.0;
+    int n_tokens = 0;
+    for (int step = 0; step < max_tokens; ++step) {
+        const float* logits = whisper_get_logits_from_state(state);
+        const whisper_token top = step == 0 ? eot - 1 : eot;    // no blank transcript
+        const float max_logit = *std::max_element(logits, logits + top + 1);
+        double sum = 0.0;
+        for (whisper_token t = 0; t <= top; ++t) sum += std::exp(static_cast<double>(logits[t] - max_logit));
+        whisper_token token;
+        if (temperature <= 0.0f) {
+            token = static_cast<whisper_token>(std::max_element(logits, logits + top + 1) - logits);
+        } else {
+            for (whisper_token t = 0; t <= top; ++t) {
+                weights[static_cast<size_t>(t)] = std::exp(static_cast<double>(logits[t] - max_logit) / temperature);
+            }
+            std::discrete_distribution<int> pick(weights.begin(), weights.begin() + top + 1);
+            token = pick(rng);
+        }
+        logprob += static_cast<double>(logits[token] - max_logit) - std::log(sum);
+        ++n_tokens;
+        if (token == eot) break;
+        result.text += whisper_token_to_str(ctx, token);
+        const size_t loop = textscore::repetition_start(result.text, constants::kRepeatMaxNgram,
+                                                        constants::kRepeatMinRepeats, constants::kRepeatMinWords);
+        if (loop != std::string::npos) {
+            result.text.erase(loop);
+            while (!result.text.empty() && result.text.back() == ' ') result.text.pop_back();
+            result.degenerate = true;
+            break;
+        }
+        if (!feed(token)) break;
+    }
+    if (n_tokens > 0) result.avg_logprob = static_cast<float>(logprob / n_tokens);
+    result.score = textscore::score(result.avg_logprob, result.no_speech_prob);
+    return result;
+}
+
+bool WhisperProcessor::hasLastClip() const {
+    std::lock_guard<std::mutex> lk(lastMutex);
+    return !last.prepared.empty();
+}
+
+void WhisperProcessor::dropEncoded() {
+    std::unique_ptr<WhisperContext::StateLease> doomed;
+    std::lock_guard<std::mutex> lk(lastMutex);
+    doomed = std::move(last.encoded);
+    ++last.serial;
+}
+
+TranscriptionResult WhisperProcessor::retranscribeLast(const DecodeOptions& options) {
+    trace::Span span("retranscribe");
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<float> prepared;
+    std::string detected;
+    uint64_t serial = 0;
+    {
+        std::lock_guard<std::mutex> lk(lastMutex);
+        prepared = last.prepared;
+        detected = last.language;
+        serial = last.serial;
+    }
+    if (!context.valid() || prepared.empty()) return selectBestResult({});
+
+    DecodeOptions again = options;
+    again.keepForRetranscribe = false;
+    const audio::Compacted compacted = compactClip(prepared, options.compactPauses);
+    const std::vector<float>& audio = compacted.offsets.empty() ? prepared : compacted.audio;
+    whisper_context* ctx = context.get();
+    const int threads = options.threads;
+    auto full_decode = [&](const char* why) {
+        if (logging) std::cout << "[rose] re-transcribe: full decode (" << why << ")\n";
+        return decode(prepared, again);
+    };
+    if (audio.size() > static_cast<size_t>(constants::kSampleRate) * constants::kWhisperWindowSeconds) {
+        return full_decode("longer than one window");
+    }
+    if (cache) {
+        TranscriptionResult hit;
+        if (cache->lookup(TranscriptCache::makeKey(prepared, modelId, options.language, options.bestOfN), hit)) {
+            return hit;
+        }
+    }
+
+    // The state is borrowed from `last` and handed back for the next correction.
+    std::unique_ptr<WhisperContext::StateLease> encoded;
+    {
+        std::lock_guard<std::mutex> lk(lastMutex);
+        if (last.serial == serial) encoded = std::move(last.encoded);
+    }
+    auto hand_back = [&]() {
+        std::lock_guard<std::mutex> lk(lastMutex);
+        if (last.serial == serial && !last.encoded) {
+            last.encoded = std::move(encoded);
+            last.language = detected;
+        }
+    };
+    // Encoded here when the probe did not run.
+    const bool reused = static_cast<bool>(encoded);
+    if (!encoded) {
+        auto state = context.acquireState();
+        if (!state ||
+            whisper_pcm_to_mel_with_state(ctx, state.get(), audio.data(), static_cast<int>(audio.size()), threads) != 0 ||
+            whisper_encode_with_state(ctx, state.get(), 0, threads) != 0) {
+            return full_decode("encode failed");
+        }
+        encoded = std::make_unique<WhisperContext::StateLease>(std::move(state));
+    }
+
+    std::string language = options.language;
+    if (language == "auto" || language.empty()) {
+        language = detected;
+        if (language.empty() && whisper_is_multilingual(ctx)) {
+            // Detection runs the encoder on the same window, so the state stays valid.
+            std::vector<float> probs(static_cast<size_t>(whisper_lang_max_id()) + 1, 0.0f);
+            const int id = whisper_lang_auto_detect_with_state(ctx, encoded->get(), 0, threads, probs.data());
+            if (id >= 0 && id <= whisper_lang_max_id()) language = detected = whisper_lang_str(id);
+        }
+        if (language.empty()) language = "en";
+    }
+    const int lang_id = whisper_lang_id(language.c_str());
+    if (lang_id < 0) {
+        hand_back();
+        return full_decode("unknown language");
+    }
+
+    const auto& temperatures = constants::Temperatures();
+    const int count = candidateCount(options);
+    std::vector<TranscriptionResult> results;
+    for (int i = 0; i < count; ++i) {
+        results.push_back(decodeEncoded(encoded->get(), lang_id, temperatures[i], threads, static_cast<uint32_t>(i)));
+    }
+    TranscriptionResult best = selectBestResult(results);
+    // The decoder cannot end at step 0, so silence still yields text; drop it
+    // on the same thresholds whisper_full uses to skip a silent window.
+    if (best.no_speech_prob > constants::kNoSpeechProbThreshold &&
+        best.avg_logprob < constants::kWhisperLogprobThold) {
+        if (logging) std::cout << "[rose] re-transcribe: no speech (p=" << best.no_speech_prob << ")\n";
+        best.text.clear();
+    }
+    if (!best.text.empty()) {
+        best.segments = { TranscriptSegment{ best.text, 0,
+                                             static_cast<int64_t>(prepared.size()) * 1000 / constants::kSampleRate } };
+    }
+
+    hand_back();
+    static metrics::Histogram& seconds = metrics::histogram(
+        "rose_retranscribe_seconds", "Time to re-transcribe the last clip with new settings.");
+    seconds.observe(elapsed_ms(t0) / 1000.0);
+    if (logging) {
+        std::cout << "[rose] re-transcribe: " << static_cast<int>(elapsed_ms(t0)) << " ms, decoder only ("
+                  << (reused ? "kept" : "new") << " encoding, " << language << ", " << count << " candidates)\n";
+    }
+    return best;
+}
+
+std::vector<TranscriptionResult> WhisperProcessor::decodePacked(
+    const std::vector<std::vector<float>>& prepared, const DecodeOptions& options) {
+
+    std::vector<TranscriptionResult> results(prepared.size(), selectBestResult({}));
+
+    // The cache is not used here: its keys stand for a single decode of the
+    // clip, which a text split out of a packed window is not, and --verify-pack
+    // compares the two.
+    const auto windows = packing::pack(prepared, constants::kSampleRate, constants::kPackWindowMs,
+                                       constants::kPackGapMs, constants::kPackMaxClips);
+
+    DecodeOptions packed = options;
+    packed.wordSegments = true;
+    // Compaction would cut the kPackGapMs silences between clips down to
+    // kPauseKeepMs, and whisper could then run one segment across two clips.
+    packed.compactPauses = false;
+    rose::TaskGroup group(options.executor ? *options.executor : rose::Executor::shared());
+    for (const auto& window : windows) {
+        group.run([this, &window, &packed, &results]() {
+            const TranscriptionResult whole = decode(window.audio, packed);
+            const auto texts = packing::split(whole.segments, window.spans);
+            for (size_t s = 0; s < window.spans.size(); ++s) {
+                TranscriptionResult& r = results[window.spans[s].clip];
+                r = whole;
+                r.text = texts[s];
+                r.segments.clear();
+            }
+        });
+    }
+    group.wait();
+    return results;
+}
+
+TranscriptionResult WhisperProcessor::decodeChunked(const audio::SpillStore& store,
+                                                   const DecodeOptions& options) {
+    trace::Span span("decode.chunked", static_cast<int64_t>(store.size()));
+    const size_t window = static_cast<size_t>(constants::kSampleRate) * constants::kSpillDecodeSeconds;
+    const size_t search = static_cast<size_t>(constants::kSampleRate) * constants::kSpillCutSearchSeconds;
+
+    // Windows are not probed one by one: a quiet stretch mid-recording is not
+    // a silent clip, and the language is settled once on the first window.
+    DecodeOptions chunk_options = options;
+    chunk_options.deadlineMs = 0;
+    chunk_options.keepForRetranscribe = false;
+    chunk_options.noSpeechProbe = false;
+    bool language_settled = !(options.language == "auto" || options.language.empty());
+    std::string so_far;
+    if (options.onPartial) {
+        chunk_options.onPartial = [&so_far, &options](const std::string& text) {
+            options.onPartial(so_far.empty() || text.empty() ? so_far + text : so_far + " " + text);
+        };
+    }
+
+    TranscriptionResult out = selectBestResult({});
+    double logprob_sum = 0.0, no_speech_sum = 0.0;
+    size_t weight = 0, windows = 0;
+    std::vector<float> samples;
+    samples.reserve(window);
+    size_t begin = 0;
+    while (begin < store.size()) {
+        const size_t end = audio::chunk_end(store, begin, window, search, constants::kSampleRate);
+        const size_t n = end - begin;
+        const int16_t* src = store.data(begin);
+        const float peak = static_cast<float>(audio::peak_int16(src, n)) / 32768.0f;
+        const float gain = peak > 0.0f && peak < constants::kAutoGainThreshold
+            ? constants::kAutoGainTarget / peak : 1.0f;
+        samples.resize(n);
+        audio::int16_to_float(src, n, gain, samples.data());
+        store.release(begin, n);
+
+        // prepare() without its silence trim, which would shift the window off
+        // the recording's timeline.
+        const std::vector<float> prepared = normalizeAudio(removeNoise(applyHighPassFilter(samples)));
+        if (!language_settled && context.valid()) {
+            chunk_options.language = probeClip(prepared, chunk_options, false).language;
+            language_settled = true;
+        }
+        const TranscriptionResult part = decode(prepared, chunk_options);
+        const int64_t offset_ms = static_cast<int64_t>(begin) * 1000 / constants::kSampleRate;
+        if (!part.text.empty()) {
+            if (!out.text.empty()) out.text += " ";
+            out.text += part.text;
+            logprob_sum += static_cast<double>(part.avg_logprob) * n;
+            no_speech_sum += static_cast<double>(part.no_speech_prob) * n;
+            weight += n;
+        }
+        for (const auto& seg : part.segments) {
+            out.segments.push_back({ seg.text, seg.t0_ms + offset_ms, seg.t1_ms + offset_ms });
+        }
+        ++windows;
+        so_far = out.text;
+        if (options.onPartial) options.onPartial(so_far);
+        begin = end;
+    }
+    if (weight > 0) {
+        out.avg_logprob = static_cast<float>(logprob_sum / weight);
+        out.no_speech_prob = static_cast<float>(no_speech_sum / weight);
+        out.score = textscore::score(out);
+    }
+    if (logging) {
+        std::cout << "[rose] long recording: " << store.size() / constants::kSampleRate << " s decoded in "
+                  << windows << " windows\n";
+    }
+    return out;
+}
+
+void WhisperProcessor::recordLatency(double total_ms) {
+    std::lock_guard<std::mutex> lk(statsMutex);
+    if (stats.transcriptions++ == 0) {
+        stats.first_ms = total_ms;
+        if (logging) {
+            std::cout << "[rose] latency: " << static_cast<int>(total_ms) << " ms (first"
+                      << (stats.warmup_ms > 0.0 ? ", warmed" : ", cold") << ")\n";
+        }
+    } else {
+        stats.steady_total_ms += total_ms;
+        if (logging) {
+            std::cout << "[rose] latency: " << static_cast<int>(total_ms) << " ms (steady avg "
+                      << static_cast<int>(stats.steadyAverageMs()) << " ms, first "
+                      << static_cast<int>(stats.first_ms) << " ms)\n";
+        }
+    }
 }
 
 void WhisperProcessor::unload() {
+    trace::Span span("model.unload");
+    dropEncoded();
     context.reset();
+    std::lock_guard<std::mutex> lk(statsMutex);
+    stats = LatencyStats{};
 }
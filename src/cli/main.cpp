@@ -0,0 +1,406 @@
+// rose-cli: headless batch transcription over files and directories of WAVs.
+// Runs the same preprocessing, candidate decoding and scoring as the app and
+// writes one JSON object per file. With --socket the files are sent to a
+// running rose-daemon instead of loading a model here; with --pack several
+// short files share one encoder window.
+
+#include "AudioFile.h"
+#include "Constants.h"
+#include "DaemonProtocol.h"
+#include "Json.h"
+#include "Metrics.h"
+#include "ModelCatalog.h"
+#include "OutputSink.h"
+#include "ThreadPolicy.h"
+#include "Trace.h"
+#include "TranscriptCache.h"
+#include "WhisperProcessor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct CliOptions {
+    std::string model;
+    std::string size = "tiny";
+    std::string quant = constants::kDefaultQuantization;
+    std::string output;
+    std::string socket;
+    std::string cache;
+    size_t cache_mb = constants::kCacheDefaultMaxMB;
+    std::string trace;
+    std::string metrics;
+    int workers = 0;
+    bool pack = false;
+    bool verify_pack = false;
+    bool stream = false;
+    DecodeOptions decode;
+    std::vector<std::string> inputs;
+};
+
+void usage() {
+    std::cerr <<
+        "usage: rose-cli [options] <file.wav|dir>...\n"
+        "  -m, --model PATH      ggml model file (default: discovered from --size/--quant)\n"
+        "      --size NAME       tiny|base|small|medium|large (default tiny)\n"
+        "      --quant NAME      auto|f16|q8_0|q5_1|q5_0 (default auto)\n"
+        "  -l, --language LANG   language code or auto (default en)\n"
+        "  -n, --best-of N       temperature candidates per file (default 1)\n"
+        "  -w, --workers N       files decoded concurrently (default cores / threads)\n"
+        "  -t, --threads N       whisper threads per decoder (default " << constants::kWhisperThreads << ")\n"
+        "      --gpu             decode on the GPU backend\n"
+        "      --deadline MS     cut each decode off after MS and keep what it has (marked truncated)\n"
+        "      --no-probe        decode every file in full, without the no-speech probe first\n"
+        "  -o, --output FILE     JSON Lines output (default stdout)\n"
+        "      --stream          show each file's text on stderr as it decodes (one worker, no packing)\n"
+        "      --pack            decode short files several to one encoder window\n"
+        "      --verify-pack     with --pack, also decode each file alone and report word error rate\n"
+        "      --cache FILE      reuse results for audio already transcribed with these settings\n"
+        "      --cache-mb N      compact the cache past this size (default " << constants::kCacheDefaultMaxMB << ")\n"
+        "      --trace FILE      record a Chrome trace (chrome://tracing, Perfetto) to FILE\n"
+        "      --metrics FILE    keep Prometheus metrics in FILE (rewritten periodically)\n"
+        "      --socket PATH     send files to the rose-daemon listening on PATH\n"
+        "      --daemon          same, at the default socket (" << ipc::default_socket_path() << ")\n";
+}
+
+bool parse_args(int argc, char** argv, CliOptions& opts) {
+    opts.decode.bestOfN = 1;
+    opts.decode.gpu = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* v = nullptr;
+        if (arg == "-m" || arg == "--model") { if (!(v = value())) return false; opts.model = v; }
+        else if (arg == "--size") { if (!(v = value())) return false; opts.size = v; }
+        else if (arg == "--quant") { if (!(v = value())) return false; opts.quant = v; }
+        else if (arg == "-l" || arg == "--language") { if (!(v = value())) return false; opts.decode.language = v; }
+        else if (arg == "-n" || arg == "--best-of") {
+            if (!(v = value())) return false;
+            opts.decode.bestOfN = std::clamp(std::atoi(v), constants::kBestOfNMin, constants::kBestOfNMax);
+        }
+        else if (arg == "-w" || arg == "--workers") { if (!(v = value())) return false; opts.workers = std::max(1, std::atoi(v)); }
+        else if (arg == "-t" || arg == "--threads") { if (!(v = value())) return false; opts.decode.threads = std::max(1, std::atoi(v)); }
+        else if (arg == "--gpu") opts.decode.gpu = true;
+        else if (arg == "--deadline") { if (!(v = value())) return false; opts.decode.deadlineMs = std::max(0, std::atoi(v)); }
+        else if (arg == "--no-probe") opts.decode.noSpeechProbe = false;
+        else if (arg == "-o" || arg == "--output") { if (!(v = value())) return false; opts.output = v; }
+        else if (arg == "--stream") opts.stream = true;
+        else if (arg == "--pack") opts.pack = true;
+        else if (arg == "--verify-pack") opts.pack = opts.verify_pack = true;
+        else if (arg == "--cache") { if (!(v = value())) return false; opts.cache = v; }
+        else if (arg == "--cache-mb") { if (!(v = value())) return false; opts.cache_mb = static_cast<size_t>(std::max(1, std::atoi(v))); }
+        else if (arg == "--trace") { if (!(v = value())) return false; opts.trace = v; }
+        else if (arg == "--metrics") { if (!(v = value())) return false; opts.metrics = v; }
+        else if (arg == "--socket") { if (!(v = value())) return false; opts.socket = v; }
+        else if (arg == "--daemon") opts.socket = ipc::default_socket_path();
+        else if (arg == "-h" || arg == "--help") return false;
+        else if (!arg.empty() && arg[0] == '-') { std::cerr << "unknown option " << arg << "\n"; return false; }
+        else opts.inputs.push_back(arg);
+    }
+    return !opts.inputs.empty();
+}
+
+bool is_wav(const fs::path& p) {
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".wav";
+}
+
+std::vector<std::string> collect_files(const std::vector<std::string>& inputs) {
+    std::vector<std::string> files;
+    for (const auto& in : inputs) {
+        std::error_code ec;
+        if (fs::is_directory(in, ec)) {
+            std::vector<std::string> found;
+            for (const auto& e : fs::recursive_directory_iterator(in, ec)) {
+                if (e.is_regular_file(ec) && is_wav(e.path())) found.push_back(e.path().string());
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        } else {
+            files.push_back(in);
+        }
+    }
+    return files;
+}
+
+// One file through the daemon; `line` gets the fields after "file".
+bool transcribe_remote(int fd, uint32_t id, const std::string& path, const CliOptions& opts,
+                       std::ostringstream& line, double& duration) {
+    ipc::Request request;
+    request.id = id;
+    request.format = ipc::AudioFormat::Wav;
+    request.best_of = static_cast<uint16_t>(opts.decode.bestOfN);
+    request.language = opts.decode.language;
+    std::ifstream file(path, std::ios::binary);
+    request.payload.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    ipc::Response response;
+    std::string error;
+    if (!file.is_open()) error = "cannot open " + path;
+    else if (!ipc::write_message(fd, ipc::encode_request(request))) error = "daemon connection lost";
+    else if (!ipc::read_response(fd, response, &error)) error = "daemon: " + error;
+    if (!error.empty()) {
+        line << ",\"error\":" << json::quote(error) << "}";
+        return false;
+    }
+    // The daemon answers with a JSON object; splice its fields into ours.
+    const std::string& body = response.body;
+    line << (body.size() > 2 ? "," + body.substr(1) : std::string("}"));
+    if (response.status != ipc::Status::Ok) return false;
+    const size_t at = body.find("\"duration_s\":");
+    duration = at == std::string::npos ? 0.0 : std::atof(body.c_str() + at + 13);
+    return true;
+}
+
+std::string resolve_model(const CliOptions& opts) {
+    if (!opts.model.empty()) return opts.model;
+    return models::resolve(opts.size, opts.quant, opts.decode.gpu);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CliOptions opts;
+    if (!parse_args(argc, argv, opts)) {
+        usage();
+        return 2;
+    }
+
+    const bool remote = !opts.socket.empty();
+    const std::string modelPath = remote ? std::string() : resolve_model(opts);
+    if (!remote && modelPath.empty()) {
+        std::cerr << "[rose] no " << opts.size << " model found (use --model or place a ggml in models/)\n";
+        return 1;
+    }
+
+    const std::vector<std::string> files = collect_files(opts.inputs);
+    if (files.empty()) {
+        std::cerr << "[rose] no input files\n";
+        return 1;
+    }
+
+    std::ofstream file_out;
+    if (!opts.output.empty()) {
+        file_out.open(opts.output);
+        if (!file_out.is_open()) {
+            std::cerr << "[rose] cannot write " << opts.output << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = opts.output.empty() ? std::cout : file_out;
+
+    if (!opts.trace.empty()) trace::setEnabled(true);
+    std::unique_ptr<metrics::FileExporter> exporter;
+    if (!opts.metrics.empty()) {
+        exporter = std::make_unique<metrics::FileExporter>(opts.metrics, constants::kMetricsWriteIntervalMs);
+    }
+
+    WhisperProcessor processor;
+    processor.setLogging(false);
+    std::unique_ptr<TranscriptCache> cache;
+    if (!opts.cache.empty() && !remote) {
+        cache = std::make_unique<TranscriptCache>(opts.cache, opts.cache_mb << 20);
+        std::string error;
+        if (!cache->open(&error)) {
+            std::cerr << "[rose] cache disabled: " << error << "\n";
+            cache.reset();
+        }
+        processor.setCache(cache.get());
+    }
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    int workers = 0;
+    if (remote) {
+        std::signal(SIGPIPE, SIG_IGN);
+        // The daemon schedules decoding; a few connections keep it fed.
+        workers = opts.workers > 0 ? opts.workers : 4;
+        std::cerr << "[rose] daemon " << opts.socket << ", " << files.size() << " files, "
+                  << workers << " connections\n";
+    } else {
+        const auto t_load = std::chrono::steady_clock::now();
+        if (!processor.initialize(modelPath, opts.decode.gpu)) {
+            std::cerr << "[rose] failed to load " << modelPath << "\n";
+            return 1;
+        }
+        const double load_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_load).count();
+        workers = opts.workers > 0
+            ? opts.workers
+            : std::max(1, static_cast<int>(hw) / (opts.decode.threads * std::max(1, opts.decode.bestOfN)));
+        // Streamed text from concurrent files would interleave on one terminal.
+        if (opts.stream) {
+            workers = 1;
+            opts.pack = opts.verify_pack = false;
+        }
+        std::cerr << "[rose] model " << fs::path(modelPath).filename().string() << " (" << load_s << " s), "
+                  << files.size() << " files, " << workers << " workers x " << opts.decode.threads
+                  << " threads, best of " << opts.decode.bestOfN << "\n";
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> failed{0};
+    std::mutex out_mutex;
+    double audio_seconds = 0.0;
+    rose::StdoutSink live(std::cerr);
+
+    auto worker = [&]() {
+        const int fd = remote ? ipc::connect_unix(opts.socket) : -1;
+        for (size_t i = next.fetch_add(1); i < files.size(); i = next.fetch_add(1)) {
+            trace::Span span("file", static_cast<int64_t>(i));
+            const auto t0 = std::chrono::steady_clock::now();
+            std::vector<float> pcm;
+            std::string error;
+            std::ostringstream line;
+            line << "{\"index\":" << i << ",\"file\":" << json::quote(files[i]);
+            if (remote) {
+                double duration = 0.0;
+                if (fd < 0 || !transcribe_remote(fd, static_cast<uint32_t>(i), files[i], opts, line, duration)) {
+                    if (fd < 0) line << ",\"error\":" << json::quote("cannot connect to " + opts.socket) << "}";
+                    failed.fetch_add(1);
+                } else {
+                    std::lock_guard<std::mutex> lk(out_mutex);
+                    audio_seconds += duration;
+                }
+            } else if (!audio::load_wav(files[i], constants::kSampleRate, pcm, &error)) {
+                failed.fetch_add(1);
+                line << ",\"error\":" << json::quote(error) << "}";
+            } else {
+                const double duration = static_cast<double>(pcm.size()) / constants::kSampleRate;
+                DecodeOptions decode = opts.decode;
+                const int seq = static_cast<int>(i);
+                if (opts.stream) decode.onPartial = [&live, seq](const std::string& text) { live.partial(seq, text); };
+                const TranscriptionResult r = processor.decode(processor.prepare(pcm), decode);
+                const double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - t0).count();
+                const bool silent = r.no_speech_prob > constants::kNoSpeechProbThreshold && r.text.empty();
+                if (opts.stream) live.commit(seq, silent ? std::string() : r.text);
+                line << ",\"duration_s\":" << json::number(duration)
+                     << ",\"text\":" << json::quote(silent ? std::string() : r.text)
+                     << ",\"avg_logprob\":" << json::number(r.avg_logprob)
+                     << ",\"no_speech_prob\":" << json::number(r.no_speech_prob)
+                     << ",\"latency_ms\":" << json::number(ms);
+                if (r.truncated) line << ",\"truncated\":true";
+                if (r.degenerate) line << ",\"degenerate\":true";
+                line << "}";
+                std::lock_guard<std::mutex> lk(out_mutex);
+                audio_seconds += duration;
+            }
+            std::lock_guard<std::mutex> lk(out_mutex);
+            out << line.str() << "\n";
+        }
+        if (fd >= 0) ::close(fd);
+    };
+
+    // Packing: each worker takes a run of files, decodes them in shared
+    // windows and optionally against a per-file decode for accuracy.
+    double wer_sum = 0.0;
+    size_t wer_count = 0;
+    auto packed_worker = [&]() {
+        const size_t run = constants::kPackMaxClips;
+        for (size_t base = next.fetch_add(run); base < files.size(); base = next.fetch_add(run)) {
+            const size_t end = std::min(files.size(), base + run);
+            const auto t0 = std::chrono::steady_clock::now();
+            std::vector<std::vector<float>> prepared(end - base);
+            std::vector<double> durations(end - base, 0.0);
+            std::vector<std::string> errors(end - base);
+            for (size_t i = base; i < end; ++i) {
+                std::vector<float> pcm;
+                if (audio::load_wav(files[i], constants::kSampleRate, pcm, &errors[i - base])) {
+                    durations[i - base] = static_cast<double>(pcm.size()) / constants::kSampleRate;
+                    prepared[i - base] = processor.prepare(pcm);
+                }
+            }
+            const auto results = processor.decodePacked(prepared, opts.decode);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+            for (size_t i = base; i < end; ++i) {
+                const size_t k = i - base;
+                std::ostringstream line;
+                line << "{\"index\":" << i << ",\"file\":" << json::quote(files[i]);
+                if (!errors[k].empty()) {
+                    failed.fetch_add(1);
+                    line << ",\"error\":" << json::quote(errors[k]) << "}";
+                } else {
+                    const TranscriptionResult& r = results[k];
+                    line << ",\"duration_s\":" << json::number(durations[k])
+                         << ",\"text\":" << json::quote(r.text)
+                         << ",\"avg_logprob\":" << json::number(r.avg_logprob)
+                         << ",\"no_speech_prob\":" << json::number(r.no_speech_prob)
+                         << ",\"latency_ms\":" << json::number(ms);
+                    if (r.truncated) line << ",\"truncated\":true";
+                    if (r.degenerate) line << ",\"degenerate\":true";
+                    if (opts.verify_pack) {
+                        const TranscriptionResult single = processor.decode(prepared[k], opts.decode);
+                        const double wer = textscore::word_error_rate(single.text, r.text);
+                        line << ",\"single_text\":" << json::quote(single.text)
+                             << ",\"wer_vs_single\":" << json::number(wer);
+                        std::lock_guard<std::mutex> lk(out_mutex);
+                        wer_sum += wer;
+                        ++wer_count;
+                    }
+                    line << "}";
+                    std::lock_guard<std::mutex> lk(out_mutex);
+                    audio_seconds += durations[k];
+                }
+                std::lock_guard<std::mutex> lk(out_mutex);
+                out << line.str() << "\n";
+            }
+        }
+    };
+
+    const auto t_start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; ++w) {
+        threads.emplace_back([&] {
+            trace::setThreadName("cli.worker");
+            (void)sched::apply(sched::Role::Decode);
+            if (opts.pack && !remote) packed_worker();
+            else worker();
+        });
+    }
+    for (auto& t : threads) t.join();
+    const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    out.flush();
+
+    std::cerr << "[rose] " << files.size() - failed.load() << "/" << files.size() << " files, "
+              << audio_seconds / 3600.0 << " audio-hours in " << wall_s << " s: "
+              << (wall_s > 0.0 ? audio_seconds / wall_s : 0.0) << " audio-hours per wall-hour\n";
+    if (!remote) {
+        // CPU time, so runs with and without --no-probe show what the probe saves.
+        rusage ru {};
+        getrusage(RUSAGE_SELF, &ru);
+        const double cpu_s = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+                             (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+        std::cerr << "[rose] cpu " << cpu_s << " s; no-speech probe skipped "
+                  << processor.probeSkips() << " decodes\n";
+    }
+    if (cache) {
+        std::cerr << "[rose] cache: " << cache->hits() << " hits, " << cache->misses() << " misses, "
+                  << cache->entries() << " entries (" << cache->bytes() / (1 << 20) << " MB)\n";
+    }
+    if (wer_count > 0) {
+        std::cerr << "[rose] packed vs per-file decoding: mean WER " << wer_sum / wer_count
+                  << " over " << wer_count << " files\n";
+    }
+    if (!opts.trace.empty() && !trace::dump(opts.trace)) {
+        std::cerr << "[rose] cannot write trace " << opts.trace << "\n";
+    }
+    return failed.load() == 0 ? 0 : 1;
+}
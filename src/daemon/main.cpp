@@ -0,0 +1,174 @@
+// rose-daemon: keeps one model resident and transcribes audio sent by local
+// clients over a Unix domain socket (see DaemonProtocol.h for the framing).
+
+#include "Constants.h"
+#include "DaemonProtocol.h"
+#include "Metrics.h"
+#include "ModelCatalog.h"
+#include "Trace.h"
+#include "TranscriptCache.h"
+#include "TranscriptionServer.h"
+#include "WhisperProcessor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <pthread.h>
+#include <string>
+#include <thread>
+
+namespace {
+
+struct DaemonOptions {
+    std::string model;
+    std::string size = "small";
+    std::string quant = constants::kDefaultQuantization;
+    std::string cache;
+    size_t cache_mb = constants::kCacheDefaultMaxMB;
+    std::string trace;
+    std::string metrics;
+    ServerOptions server;
+};
+
+void usage() {
+    std::cerr <<
+        "usage: rose-daemon [options]\n"
+        "  -s, --socket PATH     listen here (default " << ipc::default_socket_path() << ")\n"
+        "  -m, --model PATH      ggml model file (default: discovered from --size/--quant)\n"
+        "      --size NAME       tiny|base|small|medium|large (default small)\n"
+        "      --quant NAME      auto|f16|q8_0|q5_1|q5_0 (default auto)\n"
+        "  -l, --language LANG   default language code or auto (default en)\n"
+        "  -n, --best-of N       default temperature candidates per request (default 1)\n"
+        "      --slots N         batches decoded at once (default cores / threads)\n"
+        "  -t, --threads N       whisper threads per slot (default " << constants::kWhisperThreads << ")\n"
+        "      --max-batch N     short requests dispatched together (default " << constants::kDaemonMaxBatch << ")\n"
+        "      --batch-window MS wait this long to fill a batch (default " << constants::kDaemonBatchWindowMs << ")\n"
+        "      --cache FILE      answer repeated audio from this transcript cache\n"
+        "      --cache-mb N      compact the cache past this size (default " << constants::kCacheDefaultMaxMB << ")\n"
+        "      --trace FILE      record a Chrome trace, written on shutdown\n"
+        "      --metrics FILE    keep Prometheus metrics in FILE (rewritten periodically)\n"
+        "      --no-pack         decode batched clips one by one instead of sharing windows\n"
+        "      --gpu             decode on the GPU backend\n"
+        "      --deadline MS     cut each decode off after MS and reply with what it has\n";
+}
+
+bool parse_args(int argc, char** argv, DaemonOptions& opts) {
+    ServerOptions& s = opts.server;
+    s.socket_path = ipc::default_socket_path();
+    s.slots = 0;
+    s.defaults.bestOfN = 1;
+    s.defaults.gpu = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* v = nullptr;
+        if (arg == "-s" || arg == "--socket") { if (!(v = value())) return false; s.socket_path = v; }
+        else if (arg == "-m" || arg == "--model") { if (!(v = value())) return false; opts.model = v; }
+        else if (arg == "--size") { if (!(v = value())) return false; opts.size = v; }
+        else if (arg == "--quant") { if (!(v = value())) return false; opts.quant = v; }
+        else if (arg == "-l" || arg == "--language") { if (!(v = value())) return false; s.defaults.language = v; }
+        else if (arg == "-n" || arg == "--best-of") {
+            if (!(v = value())) return false;
+            s.defaults.bestOfN = std::clamp(std::atoi(v), constants::kBestOfNMin, constants::kBestOfNMax);
+        }
+        else if (arg == "--slots") { if (!(v = value())) return false; s.slots = std::max(1, std::atoi(v)); }
+        else if (arg == "-t" || arg == "--threads") { if (!(v = value())) return false; s.slot_threads = std::max(1, std::atoi(v)); }
+        else if (arg == "--max-batch") { if (!(v = value())) return false; s.max_batch = static_cast<size_t>(std::max(1, std::atoi(v))); }
+        else if (arg == "--batch-window") { if (!(v = value())) return false; s.batch_window_ms = std::max(0, std::atoi(v)); }
+        else if (arg == "--cache") { if (!(v = value())) return false; opts.cache = v; }
+        else if (arg == "--cache-mb") { if (!(v = value())) return false; opts.cache_mb = static_cast<size_t>(std::max(1, std::atoi(v))); }
+        else if (arg == "--trace") { if (!(v = value())) return false; opts.trace = v; }
+        else if (arg == "--metrics") { if (!(v = value())) return false; opts.metrics = v; }
+        else if (arg == "--no-pack") s.pack = false;
+        else if (arg == "--gpu") s.defaults.gpu = true;
+        else if (arg == "--deadline") { if (!(v = value())) return false; s.defaults.deadlineMs = std::max(0, std::atoi(v)); }
+        else if (arg == "-h" || arg == "--help") return false;
+        else { std::cerr << "unknown option " << arg << "\n"; return false; }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    DaemonOptions opts;
+    if (!parse_args(argc, argv, opts)) {
+        usage();
+        return 2;
+    }
+    ServerOptions& s = opts.server;
+
+    const std::string modelPath = !opts.model.empty() ? opts.model
+                                                      : models::resolve(opts.size, opts.quant, s.defaults.gpu);
+    if (modelPath.empty()) {
+        std::cerr << "[rose] no " << opts.size << " model found (use --model or place a ggml in models/)\n";
+        return 1;
+    }
+
+    // Block the shutdown signals before any thread starts so only sigwait()
+    // below sees them; a client hanging up must not kill the daemon.
+    std::signal(SIGPIPE, SIG_IGN);
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    if (!opts.trace.empty()) trace::setEnabled(true);
+    std::unique_ptr<metrics::FileExporter> exporter;
+    if (!opts.metrics.empty()) {
+        exporter = std::make_unique<metrics::FileExporter>(opts.metrics, constants::kMetricsWriteIntervalMs);
+    }
+
+    WhisperProcessor processor;
+    processor.setLogging(false);
+    std::unique_ptr<TranscriptCache> cache;
+    if (!opts.cache.empty()) {
+        cache = std::make_unique<TranscriptCache>(opts.cache, opts.cache_mb << 20);
+        std::string error;
+        if (!cache->open(&error)) {
+            std::cerr << "[rose] cache disabled: " << error << "\n";
+            cache.reset();
+        }
+        processor.setCache(cache.get());
+    }
+    const auto t_load = std::chrono::steady_clock::now();
+    if (!processor.initialize(modelPath, s.defaults.gpu)) {
+        std::cerr << "[rose] failed to load " << modelPath << "\n";
+        return 1;
+    }
+    if (constants::kWarmupEnabled) {
+        DecodeOptions warm = s.defaults;
+        warm.threads = s.slot_threads;
+        processor.warmUp(warm);
+    }
+    const double load_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_load).count();
+
+    if (s.slots <= 0) {
+        const int hw = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        s.slots = std::max(1, hw / (s.slot_threads * std::max(1, s.defaults.bestOfN)));
+    }
+
+    TranscriptionServer server(processor, s);
+    std::string error;
+    if (!server.start(&error)) {
+        std::cerr << "[rose] " << error << "\n";
+        return 1;
+    }
+    std::cout << "[rose] daemon: " << std::filesystem::path(modelPath).filename().string() << " (" << load_s
+              << " s) on " << s.socket_path << ", " << s.slots << " slots x " << s.slot_threads
+              << " threads, batches of up to " << s.max_batch << std::endl;
+
+    int sig = 0;
+    sigwait(&signals, &sig);
+    std::cout << "[rose] daemon: shutting down" << std::endl;
+    server.stop();
+    if (!opts.trace.empty() && !trace::dump(opts.trace)) {
+        std::cerr << "[rose] cannot write trace " << opts.trace << "\n";
+    }
+    return 0;
+}
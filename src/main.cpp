@@ -5,26 +5,62 @@
 #include "MenuBarUI.h"
 #include "Settings.h"
 #include "DispatchQueue.h"
+#include "Executor.h"
+#include "Pipeline.h"
+#include "Calibration.h"
+#include "ModelCatalog.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "OutputSink.h"
+#include "ThreadPolicy.h"
 #include <iostream>
 #include <thread>
 #include <atomic>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <mutex>
 #include "Constants.h"
 
 class App {
 public:
-    App() : running(true), processingQueue("com.rose.processing") {}
+    using Clock = std::chrono::steady_clock;
+
+    App() : running(true),
+            preprocessStage("preprocess", constants::kPipelineStageCapacity),
+            decodeStage("decode", constants::kPipelineStageCapacity, sched::Role::Decode),
+            outputStage("output", constants::kPipelineStageCapacity) {}
 
     bool initialize() {
         Settings::getInstance().load();
         Settings::getInstance().setOnChangeCallback([this]{ onSettingsChange(); });
 
+        trace::setThreadName("main");
+        if (const char* path = std::getenv(constants::kTraceEnvVar); path && path[0]) {
+            tracePath = path;
+            trace::setEnabled(true);
+            std::cout << "[rose] tracing to " << tracePath << "\n";
+        }
+        if (const char* path = std::getenv(constants::kMetricsEnvVar); path && path[0]) {
+            metricsPath = path;
+            metricsExporter = std::make_unique<metrics::FileExporter>(metricsPath, constants::kMetricsWriteIntervalMs);
+            std::cout << "[rose] metrics to " << metricsPath << "\n";
+        }
+        outputSinks.push_back(std::make_unique<ClipboardSink>());
+        if (const char* path = std::getenv(constants::kTranscriptEnvVar); path && path[0]) {
+            outputSinks.push_back(std::make_unique<rose::FileSink>(path));
+            std::cout << "[rose] transcript to " << path << "\n";
+        }
+
         if (!audioRecorder.initialize()) {
             std::cerr << "[rose] audio init failed\n";
             return false;
         }
         std::cout << "[rose] audio ready\n";
+        applyEndpointing();
 
         modelReady = false;
 
@@ -34,7 +70,9 @@ public:
 
         if (!menuBar.initialize([this]() { quit(); },
                                [this]() { onSettingsChange(); },
-                               [this]() { toggleRecording(); })) {
+                               [this]() { toggleRecording(); },
+                               [this]() { calibrate(); },
+                               [this]() { retranscribeLast(); })) {
             std::cerr << "[rose] menubar init failed\n";
             return false;
         }
@@ -44,16 +82,25 @@ public:
         return true;
     }
 
+    void setLoadedModel(const std::string& path) {
+        std::lock_guard<std::mutex> lk(loadedModelMutex);
+        loadedModelPath = path;
+    }
+
     bool ensureModelLoaded() {
         if (modelReady.load(std::memory_order_relaxed)) return true;
         const std::string path = Settings::getInstance().getModelPath();
         if (whisperProcessor.initialize(path)) {
+            setLoadedModel(path);
             modelReady.store(true, std::memory_order_relaxed);
-            std::cout << "[rose] model: " << Settings::getInstance().getModelName() << "\n";
+            std::cout << "[rose] model: " << Settings::getInstance().getModelName()
+                      << " [" << std::filesystem::path(path).filename().string() << "]"
+                      << " (" << static_cast<int>(whisperProcessor.latencyStats().load_ms) << " ms)\n";
             return true;
         }
         for (const auto& fb : constants::ModelFallbacks()) {
             if (whisperProcessor.initialize(fb)) {
+                setLoadedModel(path);
                 modelReady.store(true, std::memory_order_relaxed);
                 std::cout << "[rose] model: fallback " << fb << "\n";
                 return true;
@@ -80,6 +127,15 @@ private:
     }
 
     void startRecording() {
+        // Backpressure reaches the user here: with every stage full a new clip
+        // would block the main thread, so refuse to start recording instead.
+        // Every clip, short or spilled, enters through the preprocess stage,
+        // and only the main thread pushes there, so this check is enough.
+        if (preprocessStage.full()) {
+            std::cout << "[rose] busy: " << backlogSummary() << "\n";
+            updateBacklog();
+            return;
+        }
         std::cout << "[rose] rec start\n";
         audioRecorder.startRecording();
         menuBar.setRecordingState(true);
@@ -89,46 +145,237 @@ private:
 
     void stopRecording() {
         std::cout << "[rose] rec stop\n";
+        const auto stopped = Clock::now();
         audioRecorder.stopRecording();
         menuBar.setRecordingState(false);
         cancelScheduledUnload();
-        processingQueue.async([this]{ processAudio(); });
-    }
 
-    void processAudio() {
+        // A recording that outgrew the ring is on disk; it decodes window by
+        // window and needs no preprocessing, but still queues through that
+        // stage so a full decode stage blocks its thread, not this one.
+        if (std::shared_ptr<audio::SpillStore> spilled = audioRecorder.takeSpilledCapture()) {
+            const int seq = ++clipSequence;
+            std::cout << "[rose] #" << seq << " samples: " << spilled->size() << " (on disk)\n";
+            pushStage(preprocessStage, [this, seq, stopped, spilled]{
+                pushStage(decodeStage, [this, seq, stopped, spilled]{
+                    decodeLongClip(seq, stopped, spilled);
+                });
+            });
+            return;
+        }
+
+        // Capture stage: take the clip now so the next recording cannot clear it.
         std::vector<float> audioData = audioRecorder.getAudioData();
         if (audioData.empty()) {
             std::cout << "No audio data captured\n";
             return;
         }
+        const int seq = ++clipSequence;
+        std::cout << "[rose] #" << seq << " samples: " << audioData.size() << "\n";
+        pushStage(preprocessStage, [this, seq, stopped, audio = std::move(audioData)]{
+            preprocessClip(seq, stopped, audio);
+        });
+    }
 
-        std::cout << "[rose] samples: " << audioData.size() << "\n";
+    // Clips flow preprocess -> decode -> output. Each stage is serial, so results
+    // leave in dictation order while clip N+1 preprocesses during clip N's decode.
+    void preprocessClip(int seq, Clock::time_point stopped, const std::vector<float>& audio) {
+        trace::Span span("stage.preprocess", seq);
+        std::vector<float> prepared = whisperProcessor.prepare(audio);
+        pushStage(decodeStage, [this, seq, stopped, prepared = std::move(prepared)]{
+            decodeClip(seq, stopped, prepared);
+        });
+    }
 
-        if (!ensureModelLoaded()) return;
-        std::string transcription = whisperProcessor.transcribe(audioData);
+    void decodeClip(int seq, Clock::time_point stopped, const std::vector<float>& prepared) {
+        trace::Span span("stage.decode", seq);
+        lastLongClip.reset();
+        std::string transcription;
+        if (ensureModelLoaded()) {
+            transcription = whisperProcessor.decode(prepared, clipOptions(seq, stopped)).text;
+        }
+        finishDecode(seq, stopped, std::move(transcription));
+    }
 
-        if (!transcription.empty()) {
-            std::cout << "[rose] text: " << transcription << "\n";
+    // Menu action: the last dictation again under the current settings, for a
+    // wrong language or too few candidates. Queued behind any clip still
+    // decoding, so "last" is the newest; a long recording decodes again from
+    // its file. Refused while the decode stage is full rather than blocking
+    // the menu.
+    void retranscribeLast() {
+        if (audioRecorder.isRecording()) return;
+        const int seq = ++clipSequence;
+        std::cout << "[rose] #" << seq << " re-transcribe last\n";
+        rose::Task retranscribe([this, seq, requested = Clock::now()]{
+            trace::Span span("stage.decode", seq);
+            if (lastLongClip) {
+                std::string transcription;
+                if (ensureModelLoaded()) {
+                    transcription = whisperProcessor.decodeChunked(*lastLongClip, clipOptions(seq, requested)).text;
+                }
+                finishDecode(seq, requested, std::move(transcription));
+                return;
+            }
+            if (!whisperProcessor.hasLastClip()) {
+                std::cout << "[rose] nothing to re-transcribe\n";
+                updateBacklog();
+                return;
+            }
+            std::string transcription;
+            if (ensureModelLoaded()) {
+                transcription = whisperProcessor.retranscribeLast(clipOptions(seq, requested)).text;
+            }
+            finishDecode(seq, requested, std::move(transcription));
+        });
+        if (!decodeStage.tryPush(retranscribe)) {
+            std::cout << "[rose] busy: " << backlogSummary() << "\n";
+        }
+        updateBacklog();
+    }
+
+    void decodeLongClip(int seq, Clock::time_point stopped, std::shared_ptr<audio::SpillStore> store) {
+        trace::Span span("stage.decode", seq);
+        // Kept on disk as the last clip until the next dictation replaces it.
+        lastLongClip = store;
+        std::string transcription;
+        if (ensureModelLoaded()) {
+            transcription = whisperProcessor.decodeChunked(*store, clipOptions(seq, stopped)).text;
+        }
+        finishDecode(seq, stopped, std::move(transcription));
+    }
 
-            ClipboardManager::copyToClipboard(transcription);
+    // Settings for one clip, with segments reaching the sinks as they decode;
+    // outputClip reconciles.
+    DecodeOptions clipOptions(int seq, Clock::time_point stopped) {
+        DecodeOptions options = DecodeOptions::fromSettings();
+        options.keepForRetranscribe = true;
+        options.onPartial = [this, seq, stopped, first = true](const std::string& text) mutable {
+            if (first) {
+                static metrics::Histogram& first_text = metrics::histogram(
+                    "rose_first_text_seconds", "Recording stop to the first partial text.");
+                first_text.observe(std::chrono::duration<double>(Clock::now() - stopped).count());
+                first = false;
+            }
+            for (auto& sink : outputSinks) sink->partial(seq, text);
+        };
+        return options;
+    }
+
+    void finishDecode(int seq, Clock::time_point stopped, std::string transcription) {
+        pushStage(outputStage, [this, seq, stopped, text = std::move(transcription)]{
+            outputClip(seq, stopped, text);
+        });
+        // Only start the retention timer once no further clip is waiting to decode.
+        if (decodeStage.depth() <= 1) scheduleModelUnload();
+    }
+
+    void outputClip(int seq, Clock::time_point stopped, const std::string& transcription) {
+        trace::Span span("stage.output", seq);
+        // Also when empty: it takes back partials a silent result overruled.
+        for (auto& sink : outputSinks) sink->commit(seq, transcription);
+        if (!transcription.empty()) {
+            std::cout << "[rose] #" << seq << " text: " << transcription << "\n";
             std::cout << "[rose] copied\n";
+            static metrics::Histogram& latency = metrics::histogram(
+                "rose_dictation_latency_seconds", "Recording stop to text on the clipboard.");
+            latency.observe(std::chrono::duration<double>(Clock::now() - stopped).count());
         } else {
-            std::cout << "[rose] empty\n";
+            std::cout << "[rose] #" << seq << " empty\n";
         }
-        scheduleModelUnload();
+        updateBacklog();
+    }
+
+    void pushStage(rose::PipelineStage& stage, rose::Task task) {
+        if (stage.full()) {
+            std::cout << "[rose] backpressure: " << stage.name() << " full (" << backlogSummary() << ")\n";
+        }
+        stage.push(std::move(task));
+        updateBacklog();
+    }
+
+    std::string backlogSummary() const {
+        std::string out;
+        for (const rose::PipelineStage* stage : {&preprocessStage, &decodeStage, &outputStage}) {
+            if (!out.empty()) out += ", ";
+            out += std::string(stage->name()) + " " + std::to_string(stage->depth()) + "/" +
+                   std::to_string(stage->capacity()) + " (blocked " +
+                   std::to_string(static_cast<int>(stage->blockedMs())) + " ms)";
+        }
+        return out;
+    }
+
+    void updateBacklog() {
+        const int pending = static_cast<int>(preprocessStage.depth() + decodeStage.depth() + outputStage.depth());
+        DispatchQueue::main_async([this, pending]{ menuBar.setBacklog(pending); });
+    }
+
+    // Menu action. Runs on the decode stage, which owns the model; refused
+    // while that stage is full rather than blocking the menu.
+    void calibrate() {
+        rose::Task calibration([this]{
+            unloadModel();
+            const Settings& settings = Settings::getInstance();
+            std::vector<std::pair<std::string, std::string>> familyPaths;
+            for (int m = Settings::MODEL_TINY; m <= Settings::MODEL_LARGE; ++m) {
+                const auto model = static_cast<Settings::Model>(m);
+                const std::string family = Settings::modelFamily(model);
+                const std::string path = models::resolve(family, settings.getQuantizationFor(model),
+                                                         models::gpu_backend());
+                if (!path.empty()) familyPaths.emplace_back(family, path);
+            }
+            auto profiles = calibration::run(familyPaths, models::gpu_backend(),
+                [](const std::string& line) { std::cout << "[rose] calibration: " << line << "\n"; });
+            std::cout << "[rose] calibration done (" << profiles.size() << " profiles)\n";
+            DispatchQueue::main_async([profiles = std::move(profiles)]() mutable {
+                Settings::getInstance().setCalibration(std::move(profiles));
+            });
+        });
+        if (decodeStage.tryPush(calibration)) {
+            std::cout << "[rose] calibrating\n";
+        } else {
+            std::cout << "[rose] busy, calibration not started: " << backlogSummary() << "\n";
+        }
+        updateBacklog();
     }
 
     void onSettingsChange() {
         std::cout << "[rose] settings changed\n";
-        modelReady.store(false, std::memory_order_relaxed);
+        // Decode settings apply per clip; only another model file needs a
+        // reload, which would also drop the last clip's kept encoding.
+        {
+            std::lock_guard<std::mutex> lk(loadedModelMutex);
+            if (Settings::getInstance().getModelPath() != loadedModelPath) {
+                modelReady.store(false, std::memory_order_relaxed);
+            }
+        }
         hotkeyMonitor.update();
+        applyEndpointing();
         menuBar.updateMenu();
     }
 
+    // Auto stop runs the normal stop path, so the clip enters the pipeline at
+    // once instead of waiting for the hotkey.
+    void applyEndpointing() {
+        audioRecorder.setEndpointing(Settings::getInstance().getEndpointSilenceMs(), [this]{
+            DispatchQueue::main_async([this]{
+                // Skip if the user already stopped (and maybe restarted) by hand.
+                if (audioRecorder.isRecording() && audioRecorder.endpointReached()) {
+                    std::cout << "[rose] endpoint\n";
+                    stopRecording();
+                }
+            });
+        });
+    }
+
     void quit() {
         running = false;
         hotkeyMonitor.stop();
         Settings::getInstance().save();
+        // exit() skips the exporter's destructor; write the final snapshot here.
+        if (!metricsPath.empty()) (void)metrics::writeFile(metricsPath);
+        if (!tracePath.empty() && !trace::dump(tracePath)) {
+            std::cerr << "[rose] trace write failed: " << tracePath << "\n";
+        }
         exit(0);
     }
 
@@ -138,17 +385,33 @@ private:
     MenuBarUI menuBar;
     std::atomic<bool> running;
     std::atomic<bool> modelReady{false};
+    std::mutex loadedModelMutex;
+    std::string loadedModelPath;    // settings path of the loaded model
+    std::string tracePath;   // from ROSE_TRACE; written on quit
+    std::string metricsPath; // from ROSE_METRICS; rewritten periodically
+    std::unique_ptr<metrics::FileExporter> metricsExporter;
+    std::vector<std::unique_ptr<rose::OutputSink>> outputSinks;  // set up in initialize()
     std::atomic<bool> modelLoading{false};
-    DispatchQueue processingQueue;
+    rose::PipelineStage preprocessStage;
+    rose::PipelineStage decodeStage;
+    rose::PipelineStage outputStage;
+    std::atomic<int> clipSequence{0};
+    std::shared_ptr<audio::SpillStore> lastLongClip;   // decode stage only
 
     void preloadModelAsync() {
         if (modelReady.load(std::memory_order_relaxed)) return;
         bool expected = false;
         if (!modelLoading.compare_exchange_strong(expected, true, std::memory_order_relaxed)) return;
-        processingQueue.async([this]{
-            (void)ensureModelLoaded();
+        rose::Task preload([this]{
+            // Warm-up runs here, while the user is still speaking, so the first
+            // dictation after a load sees steady-state latency.
+            if (ensureModelLoaded() && constants::kWarmupEnabled) {
+                (void)whisperProcessor.warmUp(DecodeOptions::fromSettings());
+            }
             modelLoading.store(false, std::memory_order_relaxed);
         });
+        // A busy decode stage means the model is in use; nothing to preload.
+        if (!decodeStage.tryPush(preload)) modelLoading.store(false, std::memory_order_relaxed);
     }
 
     void unloadModel() {
@@ -164,7 +427,9 @@ private:
         dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t)seconds * NSEC_PER_SEC);
         dispatch_after(when, dispatch_get_main_queue(), ^{
             if (unloadGeneration.load() == gen) {
-                processingQueue.async([this]{ unloadModel(); });
+                // Skip when busy; the clip being decoded re-arms the timer.
+                rose::Task unload([this]{ unloadModel(); });
+                (void)decodeStage.tryPush(unload);
             }
         });
     }
@@ -177,6 +442,8 @@ private:
 };
 
 int main() {
+    // Before App starts its stage threads, so they see the reservation.
+    sched::reserveAudioCpu();
     App app;
     if (!app.initialize()) {
         std::cerr << "[rose] init failed\n";
@@ -6,6 +6,36 @@
 #include "Constants.h"
 #include "AudioUtils.h"
 #include "TextScoring.h"
+#include "ModelCatalog.h"
+#include "Calibration.h"
+#include "Executor.h"
+#include "Pipeline.h"
+#include "Json.h"
+#include "DaemonProtocol.h"
+#include "FairQueue.h"
+#include "ClipPacking.h"
+#include "TranscriptCache.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "Endpointer.h"
+#include "LanguageSession.h"
+#include "OutputSink.h"
+#include "Settings.h"
+#include "ThreadPolicy.h"
+#include "SpillStore.h"
+#include "RunawayGuard.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 using std::vector;
 
@@ -31,6 +61,72 @@ static void test_text_scoring() {
         std::cerr << "select_best failed" << std::endl;
         std::abort();
     }
+
+    // A decode cut off at its deadline loses to any finished one.
+    v[1].truncated = true;
+    if (textscore::select_best(v).text != "hello") {
+        std::cerr << "select_best preferred a truncated result" << std::endl;
+        std::abort();
+    }
+    // A candidate the deadline stopped before it started loses to one cut
+    // off with partial text, whatever that text scored.
+    {
+        TranscriptionResult never_ran;
+        never_ran.avg_logprob = -std::numeric_limits<float>::infinity();
+        never_ran.score = -std::numeric_limits<float>::infinity();
+        never_ran.truncated = true;
+        TranscriptionResult partial;
+        partial.text = "partial";
+        partial.avg_logprob = -2.5f;
+        partial.no_speech_prob = 0.1f;
+        partial.score = textscore::score(partial.avg_logprob, partial.no_speech_prob);
+        partial.truncated = true;
+        if (textscore::select_best({ never_ran, partial }).text != "partial") {
+            std::cerr << "select_best preferred a candidate that never ran" << std::endl;
+            std::abort();
+        }
+    }
+    // A looping decode loses even to a truncated one.
+    v[0].degenerate = true;
+    v[2].degenerate = true;
+    if (textscore::select_best(v).text != "world") {
+        std::cerr << "select_best preferred a degenerate result" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_repetition_start() {
+    const auto loop_at = [](const std::string& text) {
+        return textscore::repetition_start(text, constants::kRepeatMaxNgram,
+                                           constants::kRepeatMinRepeats, constants::kRepeatMinWords);
+    };
+    const std::string lead = "Okay, so the plan is";
+    const std::string phrase = " thank you for watching.";
+    std::string looped = lead;
+    for (int i = 0; i < 5; ++i) looped += phrase;
+    // Cut at the second copy's first word, keeping one copy.
+    if (loop_at(looped) != lead.size() + phrase.size() + 1) {
+        std::cerr << "repetition_start = " << loop_at(looped) << std::endl;
+        std::abort();
+    }
+    if (loop_at(" the the The the the the the the the the the THE") != 5) {
+        std::cerr << "single-word loop not found" << std::endl;
+        std::abort();
+    }
+    // Ordinary repeats are not loops: too few copies, or too few words.
+    const char* fine[] = {
+        "",
+        "no no no, not that one",
+        "thank you for watching. thank you for watching.",
+        "go go go go go go",
+        "we need to test, test, and test again before we ship this",
+    };
+    for (const char* text : fine) {
+        if (loop_at(text) != std::string::npos) {
+            std::cerr << "false repetition loop in: " << text << std::endl;
+            std::abort();
+        }
+    }
 }
 
 static void test_audio_preprocessing() {
@@ -90,9 +186,748 @@ static void test_audio_preprocessing() {
     }
 }
 
+static void test_model_catalog() {
+    models::ModelFile m;
+    if (!models::parse_model_filename("ggml-small.en-q5_1.bin", m) ||
+        m.size != "small" || !m.english_only || m.quant != models::Quantization::Q5_1) {
+        std::cerr << "parse of quantized model name failed" << std::endl;
+        std::abort();
+    }
+    if (!models::parse_model_filename("ggml-large-v3.bin", m) ||
+        m.size != "large-v3" || m.english_only || m.quant != models::Quantization::F16) {
+        std::cerr << "parse of large-v3 model name failed" << std::endl;
+        std::abort();
+    }
+    if (models::parse_model_filename("ggml-silero-v5.1.2.bin", m) ||
+        models::parse_model_filename("ggml-base.en.mlmodelc", m)) {
+        std::cerr << "non-model file accepted" << std::endl;
+        std::abort();
+    }
+
+    vector<models::ModelFile> found;
+    for (const char* name : {"ggml-base.en.bin", "ggml-base.en-q5_1.bin", "ggml-base.en-q8_0.bin", "ggml-tiny.en.bin"}) {
+        models::ModelFile f;
+        models::parse_model_filename(name, f);
+        f.path = name;
+        found.push_back(f);
+    }
+    const auto* cpu = models::select(found, "base", "auto", false);
+    const auto* gpu = models::select(found, "base", "auto", true);
+    const auto* pinned = models::select(found, "base", "q8_0", false);
+    const auto* missing = models::select(found, "base", "q5_0", true);
+    if (!cpu || cpu->path != "ggml-base.en-q5_1.bin" ||
+        !gpu || gpu->path != "ggml-base.en.bin" ||
+        !pinned || pinned->path != "ggml-base.en-q8_0.bin" ||
+        !missing || missing->path != "ggml-base.en.bin" ||
+        models::select(found, "small", "auto", false) != nullptr) {
+        std::cerr << "model variant selection failed" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_calibration_choice() {
+    // tiny meets any budget; small only with 4 threads; medium never fits 1 s.
+    vector<calibration::ModelProfile> profiles = {
+        {"tiny", 2, 60.0, 2.0},
+        {"small", 2, 900.0, 10.0},
+        {"small", 4, 500.0, 6.0},
+        {"medium", 4, 2500.0, 20.0},
+    };
+    calibration::Choice c;
+    if (!calibration::choose(profiles, 1000.0, 1, 8, c) || c.family != "small" || c.threads != 4 || !c.meets_target) {
+        std::cerr << "calibration did not pick the largest model within budget" << std::endl;
+        std::abort();
+    }
+    // Four 4-thread candidates on 8 cores double the predicted latency.
+    if (!calibration::choose(profiles, 1000.0, 4, 8, c) || c.family != "tiny") {
+        std::cerr << "calibration ignored candidate oversubscription" << std::endl;
+        std::abort();
+    }
+    if (!calibration::choose(profiles, 10.0, 1, 8, c) || c.family != "tiny" || c.meets_target) {
+        std::cerr << "calibration fallback to fastest profile failed" << std::endl;
+        std::abort();
+    }
+
+    calibration::ModelProfile p;
+    if (!calibration::parse(calibration::serialize(profiles[2]), p) ||
+        p.family != "small" || p.threads != 4 || std::abs(p.encode_ms - 500.0) > 1e-3) {
+        std::cerr << "calibration round-trip failed" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_executor() {
+    int a = 0, b = 0, c = 0;
+    rose::Task small([&a, &b, &c] { a = b + c + 1; });
+    if (!small.isInline()) {
+        std::cerr << "small task was heap allocated" << std::endl;
+        std::abort();
+    }
+    rose::Task moved = std::move(small);
+    moved();
+    if (a != 1 || small) {
+        std::cerr << "task move/invoke failed" << std::endl;
+        std::abort();
+    }
+
+    rose::Executor pool(3);
+    std::atomic<int> sum{0};
+    {
+        rose::TaskGroup group(pool);
+        for (int i = 1; i <= 1000; ++i) group.run([&sum, i] { sum.fetch_add(i); });
+        group.wait();
+    }
+    if (sum.load() != 500500) {
+        std::cerr << "task group lost tasks" << std::endl;
+        std::abort();
+    }
+
+    vector<int> order;
+    std::mutex order_mutex;
+    {
+        rose::SerialQueue serial("test.serial", pool);
+        for (int i = 0; i < 200; ++i) {
+            serial.async([&order, &order_mutex, i] {
+                std::lock_guard<std::mutex> lk(order_mutex);
+                order.push_back(i);
+            });
+        }
+    }
+    for (int i = 0; i < 200; ++i) {
+        if (order.size() != 200 || order[i] != i) {
+            std::cerr << "serial queue ran out of order" << std::endl;
+            std::abort();
+        }
+    }
+}
+
+static void test_pipeline_order_and_backpressure() {
+    vector<int> out;
+    std::mutex out_mutex;
+    {
+        rose::PipelineStage decode("decode", 1);
+        rose::PipelineStage output("output", 4);
+        rose::PipelineStage preprocess("preprocess", 2);
+        for (int i = 0; i < 6; ++i) {
+            preprocess.push([&, i] {
+                decode.push([&, i] {
+                    // Slow middle stage forces preprocess to block on push.
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                    output.push([&, i] {
+                        std::lock_guard<std::mutex> lk(out_mutex);
+                        out.push_back(i);
+                    });
+                });
+            });
+        }
+        while (true) {
+            std::lock_guard<std::mutex> lk(out_mutex);
+            if (out.size() == 6) break;
+        }
+        if (decode.blockedMs() <= 0.0 || decode.highWater() != 1) {
+            std::cerr << "pipeline backpressure not recorded" << std::endl;
+            std::abort();
+        }
+    }
+    for (int i = 0; i < 6; ++i) {
+        if (out[i] != i) {
+            std::cerr << "pipeline reordered results" << std::endl;
+            std::abort();
+        }
+    }
+}
+
+static void test_json_quote() {
+    if (json::quote("say \"hi\"\n\tnow\\") != "\"say \\\"hi\\\"\\n\\tnow\\\\\"" ||
+        json::quote(std::string("\x01")) != "\"\\u0001\"" ||
+        json::number(1.0 / 0.0) != "null") {
+        std::cerr << "json escaping failed" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_daemon_protocol() {
+    ipc::Request req;
+    req.id = 7;
+    req.format = ipc::AudioFormat::PcmS16;
+    req.sample_rate = 8000;
+    req.best_of = 3;
+    req.language = "de";
+    req.payload = { 0x00, 0x40, 0x00, 0xC0 };   // 0.5, -0.5 as int16
+    const auto bytes = ipc::encode_request(req);
+
+    ipc::Request back;
+    uint32_t n = 0;
+    if (bytes.size() != ipc::kRequestHeaderSize + 4 || !ipc::decode_request_header(bytes.data(), back, n) ||
+        n != 4 || back.id != 7 || back.format != ipc::AudioFormat::PcmS16 || back.sample_rate != 8000 ||
+        back.best_of != 3 || back.language != "de") {
+        std::cerr << "daemon request header round trip failed" << std::endl;
+        std::abort();
+    }
+    back.payload.assign(bytes.begin() + ipc::kRequestHeaderSize, bytes.end());
+    vector<float> pcm;
+    if (!ipc::decode_audio(back, 8000, pcm) || pcm.size() != 2 || pcm[0] != 0.5f || pcm[1] != -0.5f) {
+        std::cerr << "daemon int16 payload decode failed" << std::endl;
+        std::abort();
+    }
+
+    auto bad = bytes;
+    bad[0] = 'X';
+    if (ipc::decode_request_header(bad.data(), back, n)) {
+        std::cerr << "daemon accepted bad magic" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_fair_queue() {
+    // Client 1 pipelines four long requests, client 2 sends one: service alternates.
+    rose::FairQueue<int> fifo({ 1, 0.0, std::chrono::milliseconds(0) });
+    for (int i = 0; i < 4; ++i) fifo.push(1, 10 + i, 30.0);
+    fifo.push(2, 20, 30.0);
+    const vector<int> want = { 10, 20, 11, 12, 13 };
+    for (int w : want) {
+        const auto batch = fifo.pop();
+        if (batch.size() != 1 || batch[0] != w) {
+            std::cerr << "fair queue did not round-robin clients" << std::endl;
+            std::abort();
+        }
+    }
+
+    // Short clips from three clients arrive together and leave as one batch;
+    // a long clip is never batched.
+    rose::FairQueue<int> batched({ 4, 10.0, std::chrono::milliseconds(50) });
+    batched.push(1, 1, 2.0);
+    batched.push(2, 2, 3.0);
+    batched.push(2, 99, 60.0);
+    batched.push(3, 3, 1.0);
+    const auto first = batched.pop();
+    const auto second = batched.pop();
+    if (first != vector<int>{ 1, 2, 3 } || second != vector<int>{ 99 }) {
+        std::cerr << "fair queue micro-batching failed" << std::endl;
+        std::abort();
+    }
+    if (!batched.push(4, 5, 1.0, 1) || batched.push(4, 6, 1.0, 1)) {
+        std::cerr << "fair queue per-client limit not enforced" << std::endl;
+        std::abort();
+    }
+    batched.close();
+    if (!batched.pop().empty()) {
+        std::cerr << "closed fair queue still returned work" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_clip_packing() {
+    // 3 s, empty, 2 s, 22 s clips at 1 kHz into 28 s windows with 1 s gaps.
+    const vector<vector<float>> clips = {
+        vector<float>(3000, 0.1f), {}, vector<float>(2000, 0.2f), vector<float>(22000, 0.3f) };
+    const auto windows = packing::pack(clips, 1000, 28000, 1000, 8);
+    if (windows.size() != 2 || windows[0].spans.size() != 2 || windows[0].spans[1].clip != 2 ||
+        windows[0].spans[1].start_ms != 4000 || windows[0].spans[1].end_ms != 6000 ||
+        windows[0].audio.size() != 7000 || windows[0].audio[3500] != 0.0f ||
+        windows[1].spans.size() != 1 || windows[1].spans[0].clip != 3) {
+        std::cerr << "clip packing layout wrong" << std::endl;
+        std::abort();
+    }
+
+    // Word segments land in the clip they overlap; one straddling the gap
+    // goes to the larger overlap, one inside the gap to the nearest clip.
+    const vector<TranscriptSegment> segs = {
+        { " Hello", 100, 600 }, { " there.", 2600, 3300 }, { " Next", 3200, 3300 }, { " one", 4100, 4800 } };
+    const auto texts = packing::split(segs, windows[0].spans);
+    if (texts.size() != 2 || texts[0] != "Hello there. Next" || texts[1] != "one") {
+        std::cerr << "packed segment split wrong: '" << texts[0] << "' / '" << texts[1] << "'" << std::endl;
+        std::abort();
+    }
+
+    if (textscore::word_error_rate("Hello, there world.", "hello there word") != 1.0 / 3.0 ||
+        textscore::word_error_rate("", "") != 0.0 ||
+        textscore::word_error_rate("a b", "a b c d") != 1.0) {
+        std::cerr << "word error rate wrong" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_transcript_cache() {
+    const std::string path = "rose_test_cache.bin";
+    std::remove(path.c_str());
+    const vector<float> pcm(1601, 0.25f);
+    const auto key = TranscriptCache::makeKey(pcm, "ggml-tiny.bin:1", "en", 5);
+    if (key == TranscriptCache::makeKey(pcm, "ggml-tiny.bin:1", "de", 5) ||
+        key == TranscriptCache::makeKey(pcm, "ggml-tiny.bin:1", "en", 1) ||
+        !(key == TranscriptCache::makeKey(pcm, "ggml-tiny.bin:1", "en", 5))) {
+        std::cerr << "cache key ignores settings" << std::endl;
+        std::abort();
+    }
+
+    {
+        TranscriptCache cache(path, 1 << 20);
+        if (!cache.open()) {
+            std::cerr << "cache open failed" << std::endl;
+            std::abort();
+        }
+        cache.store(key, TranscriptionResult{ "hello world", -0.25f, 0.1f, -0.2f });
+    }
+    {
+        // A torn append is cut off on open; the earlier record survives.
+        std::ofstream torn(path, std::ios::binary | std::ios::app);
+        torn << "garbage";
+    }
+    TranscriptCache cache(path, 4096);
+    TranscriptionResult r;
+    if (!cache.open() || !cache.lookup(key, r) || r.text != "hello world" || r.avg_logprob != -0.25f ||
+        cache.bytes() % 8 != 0) {
+        std::cerr << "cache did not persist across reopen" << std::endl;
+        std::abort();
+    }
+
+    // Past the cap, compaction keeps the entry in use and evicts old ones.
+    const std::string filler(200, 'x');
+    for (int i = 0; i < 40; ++i) {
+        cache.store(TranscriptCache::makeKey(vector<float>(1, static_cast<float>(i)), "m", "en", 1),
+                    TranscriptionResult{ filler, -1.0f, 0.0f, -1.0f });
+        cache.lookup(key, r);
+    }
+    TranscriptionResult old;
+    if (cache.bytes() > 4096 || !cache.lookup(key, r) ||
+        cache.lookup(TranscriptCache::makeKey(vector<float>(1, 0.0f), "m", "en", 1), old)) {
+        std::cerr << "cache eviction failed" << std::endl;
+        std::abort();
+    }
+    std::remove(path.c_str());
+}
+
+static void test_trace() {
+    const std::string path = "rose_test_trace.json";
+    { trace::Span off("test.disabled"); }
+
+    trace::setEnabled(true);
+    std::thread([] {
+        trace::setThreadName("test.thread");
+        trace::Span outer("test.outer", 7);
+        trace::Span inner("test.inner");
+    }).join();
+    // Overfill this thread's ring; only the newest events are kept.
+    for (size_t i = 0; i < constants::kTraceRingEvents + 100; ++i) trace::instant("test.tick");
+    trace::setEnabled(false);
+    { trace::Span off("test.disabled"); }
+
+    if (!trace::dump(path)) {
+        std::cerr << "trace dump failed" << std::endl;
+        std::abort();
+    }
+    std::ifstream in(path);
+    const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t ticks = 0;
+    for (size_t at = text.find("\"test.tick\""); at != std::string::npos; at = text.find("\"test.tick\"", at + 1)) ++ticks;
+    if (text.find("\"traceEvents\"") == std::string::npos || text.find("\"test.thread\"") == std::string::npos ||
+        text.find("\"name\":\"test.outer\"") == std::string::npos || text.find("\"v\":7") == std::string::npos ||
+        text.find("\"test.inner\"") == std::string::npos || text.find("test.disabled") != std::string::npos ||
+        ticks != constants::kTraceRingEvents) {
+        std::cerr << "trace output wrong (" << ticks << " ticks)" << std::endl;
+        std::abort();
+    }
+    std::remove(path.c_str());
+}
+
+static void test_metrics() {
+    // Bucket bounds tile the range and every value lands inside its bucket.
+    for (uint64_t v : { uint64_t(0), uint64_t(15), uint64_t(16), uint64_t(17), uint64_t(1000), uint64_t(123456789),
+                        UINT64_MAX }) {
+        const size_t b = metrics::Histogram::bucketOf(v);
+        if (b >= metrics::Histogram::kBuckets || v < metrics::Histogram::bucketLow(b) ||
+            v > metrics::Histogram::bucketHigh(b)) {
+            std::cerr << "histogram bucket wrong for " << v << std::endl;
+            std::abort();
+        }
+    }
+
+    metrics::Histogram h(1e6);
+    for (int ms = 1; ms <= 1000; ++ms) h.observe(ms / 1000.0);
+    const double p50 = h.quantile(0.5), p99 = h.quantile(0.99);
+    if (h.count() != 1000 || std::fabs(p50 - 0.5) > 0.5 * 0.04 || std::fabs(p99 - 0.99) > 0.99 * 0.04 ||
+        std::fabs(h.sum() - 500.5) > 1e-3) {
+        std::cerr << "histogram quantiles off: p50=" << p50 << " p99=" << p99 << std::endl;
+        std::abort();
+    }
+
+    metrics::Counter& c = metrics::counter("rose_test_events_total", "Test events.");
+    c.add(3);
+    if (&c != &metrics::counter("rose_test_events_total", "Test events.") || c.value() != 3) {
+        std::cerr << "counter registry wrong" << std::endl;
+        std::abort();
+    }
+    metrics::histogram("rose_test_seconds", "Test durations.").observe(0.25);
+
+    const std::string path = "rose_test_metrics.prom";
+    if (!metrics::writeFile(path)) {
+        std::cerr << "metrics write failed" << std::endl;
+        std::abort();
+    }
+    std::ifstream in(path);
+    const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (text.find("# TYPE rose_test_events_total counter\nrose_test_events_total 3\n") == std::string::npos ||
+        text.find("rose_test_seconds{quantile=\"0.5\"} 0.2") == std::string::npos ||
+        text.find("rose_test_seconds_count 1\n") == std::string::npos) {
+        std::cerr << "metrics output wrong:\n" << text << std::endl;
+        std::abort();
+    }
+    std::remove(path.c_str());
+}
+
+static void test_endpointer() {
+    const int sr = constants::kSampleRate;
+    // 0.5 s room noise, 1 s of "speech", then 1.5 s of the same noise.
+    vector<float> clip;
+    uint32_t seed = 12345u;
+    auto noise = [&] {
+        seed = seed * 1664525u + 1013904223u;
+        return (static_cast<float>(seed >> 8) / static_cast<float>(1u << 24) - 0.5f) * 0.002f;
+    };
+    for (int i = 0; i < sr / 2; ++i) clip.push_back(noise());
+    for (int i = 0; i < sr; ++i) clip.push_back(0.2f * std::sin(i * 0.05f) + noise());
+    for (int i = 0; i < sr * 3 / 2; ++i) clip.push_back(noise());
+    const size_t speech_end = static_cast<size_t>(sr) * 3 / 2;
+
+    // Fed in callback-sized pieces: fires 0.8 s into the pause, not before.
+    audio::Endpointer ep(sr, 800);
+    size_t fired_at = 0;
+    for (size_t at = 0; at < clip.size() && !fired_at; at += 333) {
+        const size_t n = std::min<size_t>(333, clip.size() - at);
+        if (ep.push(clip.data() + at, n)) fired_at = at + n;
+    }
+    const size_t silence = static_cast<size_t>(sr) * 8 / 10;
+    if (!fired_at || fired_at < speech_end + silence || fired_at > speech_end + silence + sr / 10 ||
+        ep.speechEnd() + static_cast<size_t>(sr) / 50 < speech_end || ep.speechEnd() > speech_end + sr / 50) {
+        std::cerr << "endpoint at " << fired_at << ", speech end " << ep.speechEnd() << std::endl;
+        std::abort();
+    }
+
+    // Noise alone never ends a recording, nor does a pause shorter than the setting.
+    audio::Endpointer quiet(sr, 800);
+    audio::Endpointer patient(sr, 2000);
+    if (quiet.push(clip.data(), sr / 2) || patient.push(clip.data(), clip.size())) {
+        std::cerr << "endpoint fired without a long enough pause" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_int16_conversion() {
+    // Odd length so the scalar tail runs after the vector body; includes both extremes.
+    vector<int16_t> pcm = { -32768, 32767, 0, 1, -1, 16384, -16384 };
+    uint32_t seed = 7u;
+    for (int i = 0; i < 1001; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        pcm.push_back(static_cast<int16_t>(seed >> 16));
+    }
+    if (audio::peak_int16(pcm.data(), pcm.size()) != 32768 ||
+        audio::peak_int16(pcm.data() + 2, 5) != 16384 || audio::peak_int16(pcm.data(), 0) != 0) {
+        std::cerr << "peak_int16 wrong" << std::endl;
+        std::abort();
+    }
+    for (float gain : { 1.0f, 3.5f }) {
+        vector<float> out(pcm.size());
+        audio::int16_to_float(pcm.data(), pcm.size(), gain, out.data());
+        for (size_t i = 0; i < pcm.size(); ++i) {
+            const float want = std::max(-1.0f, std::min(1.0f, pcm[i] / 32768.0f * gain));
+            if (std::fabs(out[i] - want) > 1e-6f) {
+                std::cerr << "int16_to_float[" << i << "] = " << out[i] << ", want " << want << std::endl;
+                std::abort();
+            }
+        }
+    }
+}
+
+static void test_runaway_guard() {
+    // A 2 s clip: 48 + 2 * 12 tokens.
+    const int64_t cap = constants::kRunawayTokenSlack + 2 * constants::kRunawayTokensPerSecond;
+    rose::RunawayGuard guard(cap);
+    // A window decoded to 60 tokens, then retried from scratch by a fallback:
+    // the retry replaces the first attempt rather than adding to it.
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        for (int n = 1; n <= 60; ++n) guard.sampling(n);
+    }
+    guard.committed(" Hello there, this is a test.", 60);
+    if (guard.fired() || guard.tokens() != 60) {
+        std::cerr << "runaway guard counted a fallback retry: " << guard.tokens() << std::endl;
+        std::abort();
+    }
+    // The next window's tokens do add up with committed ones.
+    for (int n = 1; n <= cap - 60; ++n) guard.sampling(n);
+    if (guard.fired()) {
+        std::cerr << "runaway guard fired at the cap" << std::endl;
+        std::abort();
+    }
+    guard.sampling(static_cast<int>(cap - 60 + 1));
+    if (!guard.overCap() || guard.looping()) {
+        std::cerr << "runaway guard missed the token cap" << std::endl;
+        std::abort();
+    }
+
+    rose::RunawayGuard loop(1000);
+    for (int i = 0; i < 4; ++i) loop.committed(" thank you for watching.", 6);
+    if (!loop.looping() || loop.overCap()) {
+        std::cerr << "runaway guard missed a repetition loop" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_spill_store() {
+    const int sr = 1000;
+    // 6 s of tone in chunks, with a quiet stretch at 3.5 s to cut at.
+    vector<int16_t> pcm(6 * sr);
+    for (size_t i = 0; i < pcm.size(); ++i) {
+        const bool quiet = i >= 3500 && i < 3560;
+        pcm[i] = static_cast<int16_t>((quiet ? 10 : 12000) * std::sin(i * 0.3));
+    }
+    audio::SpillStore store(std::filesystem::temp_directory_path().string(), 5 * sr + 500);
+    std::string error;
+    if (!store.open(&error)) {
+        std::cerr << "spill store open failed: " << error << std::endl;
+        std::abort();
+    }
+    for (size_t at = 0; at < 5 * sr; at += 700) {
+        const size_t n = std::min<size_t>(700, 5 * sr - at);
+        if (!store.append(pcm.data() + at, n)) {
+            std::cerr << "spill append failed at " << at << std::endl;
+            std::abort();
+        }
+    }
+    // Past max_samples nothing is appended.
+    if (store.append(pcm.data() + 5 * sr, sr) || store.size() != 5 * sr || store.full()) {
+        std::cerr << "spill store cap wrong: " << store.size() << std::endl;
+        std::abort();
+    }
+    store.truncate(4 * sr);
+    if (!store.seal() || store.size() != 4 * sr || store.append(pcm.data(), 1)) {
+        std::cerr << "spill seal wrong" << std::endl;
+        std::abort();
+    }
+    if (!std::equal(pcm.begin(), pcm.begin() + 4 * sr, store.data())) {
+        std::cerr << "spilled samples differ" << std::endl;
+        std::abort();
+    }
+    store.release(0, 2 * sr);
+    if (store.data(3 * sr)[7] != pcm[3 * sr + 7]) {
+        std::cerr << "spill data wrong after release" << std::endl;
+        std::abort();
+    }
+
+    // A 3.2 s chunk searching its last 1 s cuts in the quiet stretch; the
+    // last chunk runs to the end.
+    const size_t cut = audio::chunk_end(store, 500, 3200, sr, sr);
+    if (cut < 3500 || cut > 3560) {
+        std::cerr << "chunk_end cut at " << cut << ", want ~3500" << std::endl;
+        std::abort();
+    }
+    if (audio::chunk_end(store, cut, 3 * sr, sr, sr) != store.size()) {
+        std::cerr << "chunk_end did not finish the store" << std::endl;
+        std::abort();
+    }
+
+    const float in[] = { -1.5f, -1.0f, -0.5f, 0.0f, 0.25f, 1.0f, 2.0f };
+    int16_t out[std::size(in)];
+    audio::float_to_int16(in, std::size(in), out);
+    const int16_t want[] = { -32767, -32767, -16384, 0, 8192, 32767, 32767 };
+    if (!std::equal(std::begin(want), std::end(want), out)) {
+        std::cerr << "float_to_int16 wrong" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_compact_pauses() {
+    const int sr = constants::kSampleRate;
+    // 1 s tone, 2 s near-silence, 1 s tone, 1 s trailing silence.
+    vector<float> clip;
+    for (int i = 0; i < sr; ++i) clip.push_back(0.5f * std::sin(i * 0.05f));
+    for (int i = 0; i < sr * 2; ++i) clip.push_back(0.0005f * std::sin(i * 0.05f));
+    for (int i = 0; i < sr; ++i) clip.push_back(0.5f * std::sin(i * 0.05f));
+    clip.insert(clip.end(), static_cast<size_t>(sr), 0.0f);
+
+    const audio::Compacted c = audio::compact_pauses(clip, sr, 20, 700, 300, 0.05f, 0.02f);
+    const size_t cut = static_cast<size_t>(sr) * 17 / 10;   // 2 s pause down to 0.3 s
+    if (c.offsets.empty() || c.audio.size() != clip.size() - cut) {
+        std::cerr << "compacted to " << c.audio.size() << " of " << clip.size() << std::endl;
+        std::abort();
+    }
+    // Before the pause nothing moves; the second tone maps back 1.7 s later.
+    if (c.offsets.original(sr / 2) != static_cast<size_t>(sr / 2) ||
+        c.offsets.original(c.audio.size() - 1) != clip.size() - 1 ||
+        c.offsets.originalMs(1500, sr) != 3200) {
+        std::cerr << "offset map off: " << c.offsets.originalMs(1500, sr) << std::endl;
+        std::abort();
+    }
+
+    // A pause under the threshold is kept whole.
+    vector<float> short_pause(clip.begin(), clip.begin() + sr);
+    short_pause.insert(short_pause.end(), static_cast<size_t>(sr) / 2, 0.0f);
+    short_pause.insert(short_pause.end(), clip.begin(), clip.begin() + sr);
+    const audio::Compacted kept = audio::compact_pauses(short_pause, sr, 20, 700, 300, 0.05f, 0.02f);
+    if (!kept.offsets.empty() || !kept.audio.empty() || kept.offsets.originalMs(1234, sr) != 1234) {
+        std::cerr << "short pause compacted" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_output_sinks() {
+    // Partials that extend the line print only the new words; a different
+    // final result goes on a fresh line.
+    std::ostringstream out;
+    rose::StdoutSink live(out);
+    live.partial(1, " Hello");
+    live.partial(1, " Hello world.");
+    live.commit(1, " Hello world.");
+    live.partial(2, " Their");
+    live.commit(2, " There it is.");
+    live.commit(3, "");
+    if (out.str() != " Hello world.\n Their\n There it is.\n") {
+        std::cerr << "stdout sink wrote: [" << out.str() << "]" << std::endl;
+        std::abort();
+    }
+
+    const std::string path = "/tmp/rose_test_sink.txt";
+    auto read = [&] {
+        std::ifstream in(path);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    std::remove(path.c_str());
+    rose::FileSink file(path);
+    file.partial(1, " First");
+    if (read() != " First\n") { std::cerr << "file sink partial: " << read() << std::endl; std::abort(); }
+    file.commit(1, " First words.");
+    file.commit(2, "");     // silent dictation keeps the previous text
+    if (read() != " First words.\n") { std::cerr << "file sink commit: " << read() << std::endl; std::abort(); }
+    file.partial(3, " Oops");
+    file.commit(3, "");     // overruled partials are taken back
+    if (read() != "\n") { std::cerr << "file sink reconcile: " << read() << std::endl; std::abort(); }
+    std::remove(path.c_str());
+}
+
+static void test_settings_snapshots() {
+    const std::string dir = "/tmp/rose_settings_test";
+    const std::string path = dir + "/rose_config";
+    std::filesystem::create_directories(dir);
+    std::remove(path.c_str());
+    Settings& settings = Settings::getInstance();
+    const std::string saved_path = settings.getConfigPath();
+    settings.setConfigPath(path);
+
+    // A published snapshot never changes under its reader.
+    const auto before = settings.snapshot();
+    const int original = before->bestOfN;
+    settings.setBestOfN(3);
+    const std::weak_ptr<const Settings::Values> between = settings.snapshot();
+    settings.setBestOfN(4);
+    if (before->bestOfN != original || settings.getBestOfN() != 4 || settings.snapshot() == before) {
+        std::cerr << "settings snapshot changed in place" << std::endl;
+        std::abort();
+    }
+    // Superseded snapshots nobody holds are freed.
+    if (!between.expired()) {
+        std::cerr << "superseded settings snapshot kept alive" << std::endl;
+        std::abort();
+    }
+
+    // The burst is written once it settles, with the last value.
+    auto read = [&] {
+        std::ifstream in(path);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (read().find("bestOfN=4") == std::string::npos && std::chrono::steady_clock::now() < give_up) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    if (read().find("bestOfN=4") == std::string::npos) {
+        std::cerr << "settings not saved: " << read() << std::endl;
+        std::abort();
+    }
+    settings.setBestOfN(original);
+    settings.save();
+    settings.setConfigPath(saved_path);
+    std::filesystem::remove_all(dir);
+}
+
+static void test_thread_policy() {
+    if (sched::parseCpuList("0-3,6,2") != vector<int>{0, 1, 2, 3, 6} ||
+        sched::parseCpuList("5") != vector<int>{5} ||
+        !sched::parseCpuList("3-1").empty() || !sched::parseCpuList("a,2").empty() ||
+        !sched::parseCpuList("").empty()) {
+        std::cerr << "parseCpuList wrong" << std::endl;
+        std::abort();
+    }
+    // big.LITTLE: only the fastest cores; uniform or unknown: all of them.
+    if (sched::fastestCpus({ 1800000, 1800000, 3200000, 3200000 }) != vector<int>{2, 3} ||
+        sched::fastestCpus({ 2400000, 2400000 }) != vector<int>{0, 1} ||
+        sched::fastestCpus({ 3200000, 0, 1800000 }) != vector<int>{0, 1, 2}) {
+        std::cerr << "fastestCpus wrong" << std::endl;
+        std::abort();
+    }
+    // Without a reservation decode never loses a CPU to audio.
+    if (sched::audioCpu() != -1) {
+        std::cerr << "audio CPU reserved without reserveAudioCpu()" << std::endl;
+        std::abort();
+    }
+}
+
+static void test_language_session() {
+    rose::LanguageSession session;
+    for (int i = 0; i < constants::kLanguageSessionHits; ++i) {
+        if (!session.cached().empty()) {
+            std::cerr << "language trusted too early" << std::endl;
+            std::abort();
+        }
+        session.detected("de", 0.95f);
+    }
+    if (session.cached() != "de") {
+        std::cerr << "language session not established" << std::endl;
+        std::abort();
+    }
+
+    // A weak decode forces one detection; an agreeing one restores the session.
+    session.decoded(constants::kLanguageRecheckLogprob - 0.5f);
+    if (!session.cached().empty()) {
+        std::cerr << "weak decode did not trigger a re-check" << std::endl;
+        std::abort();
+    }
+    session.detected("de", 0.9f);
+    if (session.cached() != "de") {
+        std::cerr << "re-check did not restore the session" << std::endl;
+        std::abort();
+    }
+
+    // Unsure or different detections start over.
+    session.detected("fr", 0.5f);
+    session.detected("fr", 0.9f);
+    if (!session.cached().empty()) {
+        std::cerr << "language session survived a change" << std::endl;
+        std::abort();
+    }
+}
+
 int main() {
     test_text_scoring();
+    test_repetition_start();
+    test_runaway_guard();
     test_audio_preprocessing();
+    test_model_catalog();
+    test_calibration_choice();
+    test_executor();
+    test_pipeline_order_and_backpressure();
+    test_json_quote();
+    test_daemon_protocol();
+    test_fair_queue();
+    test_clip_packing();
+    test_transcript_cache();
+    test_trace();
+    test_metrics();
+    test_endpointer();
+    test_int16_conversion();
+    test_spill_store();
+    test_compact_pauses();
+    test_output_sinks();
+    test_settings_snapshots();
+    test_thread_policy();
+    test_language_session();
     std::cout << "All tests passed\n";
     return 0;
 }